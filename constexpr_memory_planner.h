@@ -0,0 +1,141 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_CONSTEXPR_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_CONSTEXPR_MEMORY_PLANNER_H_
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "greedy_memory_planner.h"
+#include "greedy_placement.h"
+#include "memory_planner.h"
+
+// Plans memory for a graph whose buffers are all known when the firmware is
+// built, so the offsets are compile-time constants. There's no planning at
+// startup, no scratch buffer, and none of the planner code ends up in the
+// binary. For example:
+//
+//   constexpr std::array<tflite::BufferRequirements, 3> kRequirements = {{
+//       {100, 0, 1, 16}, {50, 1, 2, 16}, {100, 2, 3, 16},
+//   }};
+//   constexpr auto kPlan = tflite::CalculateConstexprMemoryPlan(kRequirements);
+//   static_assert(kPlan.is_valid, "Bad buffer requirements");
+//   alignas(16) unsigned char g_arena[kPlan.arena_size];
+//
+// This runs the same greedy algorithm as GreedyMemoryPlanner, and gives the
+// same offsets for the same requirements, ordering and gap policy. Alias
+// pairs, fixed offsets and refinement aren't supported. The loops need
+// C++14's relaxed constexpr rules, and large graphs may need the compiler's
+// constexpr operation limit raising, since the work is O(N^2) per buffer in
+// the worst case.
+
+namespace tflite {
+
+// The offset of each buffer, in the order the requirements were given, and
+// the arena size they need.
+template <std::size_t kBufferCount>
+struct ConstexprMemoryPlan {
+  std::array<int, kBufferCount> offsets;
+  int arena_size;
+  // False if any requirement had a negative size, a time range that ends
+  // before it starts, or an alignment that isn't a power of two. The offsets
+  // and arena size are all zero in that case.
+  bool is_valid;
+};
+
+namespace internal {
+
+// Working arrays for the plan. std::array can't be written to in a C++14
+// constant expression, so the offsets are built up here and copied out.
+template <std::size_t kBufferCount>
+struct ConstexprPlannerState {
+  int offsets[kBufferCount];
+  int buffer_ids_in_placement_order[kBufferCount];
+  int placement_order_keys[kBufferCount];
+  int active_offsets[kBufferCount];
+  int active_ends[kBufferCount];
+};
+
+template <std::size_t... kIndices>
+constexpr std::array<int, sizeof...(kIndices)> ToOffsetArray(const int* offsets, std::index_sequence<kIndices...>) {
+  return {{offsets[kIndices]...}};
+}
+
+}  // namespace internal
+
+template <std::size_t kBufferCount>
+constexpr ConstexprMemoryPlan<kBufferCount> CalculateConstexprMemoryPlan(const std::array<BufferRequirements, kBufferCount>& requirements, GreedyMemoryPlanner::BufferOrdering ordering = GreedyMemoryPlanner::kSizeDescending, GreedyMemoryPlanner::GapSelectionPolicy policy = GreedyMemoryPlanner::kFirstFit) {
+  static_assert(kBufferCount > 0, "A plan needs at least one buffer");
+  const int buffer_count = static_cast<int>(kBufferCount);
+  internal::ConstexprPlannerState<kBufferCount> state{};
+  for (int i = 0; i < buffer_count; ++i) {
+    const BufferRequirements& current = requirements[i];
+    if ((current.size < 0) || (current.last_time_used < current.first_time_used) || !IsValidBufferAlignment(current.alignment)) {
+      return {internal::ToOffsetArray(state.offsets, std::make_index_sequence<kBufferCount>()), 0, false};
+    }
+  }
+
+  // A stable insertion sort into placement order, so buffers with equal keys
+  // stay in the order they were given, as they do in the runtime planner.
+  for (int i = 0; i < buffer_count; ++i) {
+    const int key = internal::GetGreedyPlacementOrderKey(requirements[i], ordering);
+    int position = i;
+    while ((position > 0) && internal::IsEarlierInGreedyPlacementOrder(key, state.placement_order_keys[position - 1], ordering)) {
+      state.placement_order_keys[position] = state.placement_order_keys[position - 1];
+      state.buffer_ids_in_placement_order[position] = state.buffer_ids_in_placement_order[position - 1];
+      --position;
+    }
+    state.placement_order_keys[position] = key;
+    state.buffer_ids_in_placement_order[position] = i;
+  }
+
+  int arena_size = 0;
+  for (int i = 0; i < buffer_count; ++i) {
+    const int buffer_id = state.buffer_ids_in_placement_order[i];
+    const BufferRequirements& wanted = requirements[buffer_id];
+    // Gather the placed buffers that overlap in time, keeping them in
+    // ascending order of offset.
+    int active_count = 0;
+    for (int j = 0; j < i; ++j) {
+      const int placed_id = state.buffer_ids_in_placement_order[j];
+      const BufferRequirements& placed = requirements[placed_id];
+      if ((placed.first_time_used > wanted.last_time_used) || (placed.last_time_used < wanted.first_time_used)) {
+        continue;
+      }
+      const int placed_offset = state.offsets[placed_id];
+      int position = active_count;
+      while ((position > 0) && (state.active_offsets[position - 1] > placed_offset)) {
+        state.active_offsets[position] = state.active_offsets[position - 1];
+        state.active_ends[position] = state.active_ends[position - 1];
+        --position;
+      }
+      state.active_offsets[position] = placed_offset;
+      state.active_ends[position] = placed_offset + placed.size;
+      ++active_count;
+    }
+    const int offset = internal::ChooseGreedyOffset(state.active_offsets, state.active_ends, active_count, wanted.size, wanted.alignment, policy);
+    state.offsets[buffer_id] = offset;
+    if ((offset + wanted.size) > arena_size) {
+      arena_size = offset + wanted.size;
+    }
+  }
+  return {internal::ToOffsetArray(state.offsets, std::make_index_sequence<kBufferCount>()), arena_size, true};
+}
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_CONSTEXPR_MEMORY_PLANNER_H_
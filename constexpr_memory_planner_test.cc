@@ -0,0 +1,111 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "constexpr_memory_planner.h"
+
+#include "micro_test.h"
+
+namespace {
+
+constexpr std::array<tflite::BufferRequirements, 5> kMediumRequirements = {{
+    {10, 0, 1, 1}, {20, 1, 2, 1}, {30, 2, 3, 1}, {40, 3, 4, 1}, {50, 0, 1, 1},
+}};
+constexpr auto kMediumPlan = tflite::CalculateConstexprMemoryPlan(kMediumRequirements);
+static_assert(kMediumPlan.is_valid, "The medium plan should be valid");
+static_assert(kMediumPlan.arena_size == 90, "The medium plan should match TestGreedyMedium");
+static_assert(kMediumPlan.offsets[0] == 50, "The medium plan should match TestGreedyMedium");
+static_assert(kMediumPlan.offsets[2] == 40, "The medium plan should match TestGreedyMedium");
+
+constexpr std::array<tflite::BufferRequirements, 1> kInvalidRequirements = {{{10, 0, 1, 3}}};
+static_assert(!tflite::CalculateConstexprMemoryPlan(kInvalidRequirements).is_valid, "An alignment of three should be rejected");
+
+constexpr int kRandomBufferCount = 100;
+
+struct RandomRequirements {
+  tflite::BufferRequirements values[kRandomBufferCount];
+};
+
+// The same pseudo-random buffers as the portfolio tests, with a mix of
+// alignments. They're built in a plain array, since std::array can't be
+// written to in a C++14 constant expression.
+constexpr RandomRequirements GetRandomRequirements() {
+  RandomRequirements result = {};
+  unsigned int seed = 1;
+  for (int i = 0; i < kRandomBufferCount; ++i) {
+    tflite::BufferRequirements& current = result.values[i];
+    seed = (seed * 1103515245) + 12345;
+    current.size = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    current.first_time_used = (seed >> 16) % 50;
+    seed = (seed * 1103515245) + 12345;
+    current.last_time_used = current.first_time_used + ((seed >> 16) % 10);
+    current.alignment = 1 << (i % 5);
+  }
+  return result;
+}
+
+template <std::size_t... kIndices>
+constexpr std::array<tflite::BufferRequirements, sizeof...(kIndices)> ToRequirementsArray(const RandomRequirements& requirements, std::index_sequence<kIndices...>) {
+  return {{requirements.values[kIndices]...}};
+}
+
+}  // namespace
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestConstexprMatchesGreedy) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr std::array<tflite::BufferRequirements, kRandomBufferCount> requirements = ToRequirementsArray(GetRandomRequirements(), std::make_index_sequence<kRandomBufferCount>());
+  constexpr tflite::ConstexprMemoryPlan<kRandomBufferCount> plans[] = {
+      tflite::CalculateConstexprMemoryPlan(requirements),
+      tflite::CalculateConstexprMemoryPlan(requirements, tflite::GreedyMemoryPlanner::kLifetimeDescending, tflite::GreedyMemoryPlanner::kBestFit),
+      tflite::CalculateConstexprMemoryPlan(requirements, tflite::GreedyMemoryPlanner::kAreaDescending, tflite::GreedyMemoryPlanner::kWorstFit),
+      tflite::CalculateConstexprMemoryPlan(requirements, tflite::GreedyMemoryPlanner::kFirstUseAscending),
+  };
+  const tflite::GreedyMemoryPlanner::BufferOrdering orderings[] = {
+      tflite::GreedyMemoryPlanner::kSizeDescending,
+      tflite::GreedyMemoryPlanner::kLifetimeDescending,
+      tflite::GreedyMemoryPlanner::kAreaDescending,
+      tflite::GreedyMemoryPlanner::kFirstUseAscending,
+  };
+  const tflite::GreedyMemoryPlanner::GapSelectionPolicy policies[] = {
+      tflite::GreedyMemoryPlanner::kFirstFit,
+      tflite::GreedyMemoryPlanner::kBestFit,
+      tflite::GreedyMemoryPlanner::kWorstFit,
+      tflite::GreedyMemoryPlanner::kFirstFit,
+  };
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(kRandomBufferCount);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  for (int p = 0; p < 4; ++p) {
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    planner.SetBufferOrdering(orderings[p]);
+    planner.SetGapSelectionPolicy(policies[p]);
+    for (int i = 0; i < kRandomBufferCount; ++i) {
+      const tflite::BufferRequirements& current = requirements[i];
+      TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, current.size, current.first_time_used, current.last_time_used, current.alignment));
+    }
+    TF_LITE_MICRO_EXPECT_EQ(true, plans[p].is_valid);
+    TF_LITE_MICRO_EXPECT_EQ(planner.GetMaximumMemorySize(), plans[p].arena_size);
+    for (int i = 0; i < kRandomBufferCount; ++i) {
+      int offset = -1;
+      planner.GetOffsetForBuffer(error_reporter, i, &offset);
+      TF_LITE_MICRO_EXPECT_EQ(offset, plans[p].offsets[i]);
+    }
+  }
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -0,0 +1,101 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "file_memory_plan_store.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace tflite {
+
+FileMemoryPlanStore::FileMemoryPlanStore(ErrorReporter* error_reporter, const char* directory, unsigned char* buffer, int buffer_size) : error_reporter_(error_reporter), buffer_(buffer), buffer_size_(buffer_size) {
+  const size_t length = strlen(directory);
+  is_directory_valid_ = (length < kMaxPathLength);
+  if (is_directory_valid_) {
+    memcpy(directory_, directory, length + 1);
+  } else {
+    directory_[0] = 0;
+  }
+}
+
+bool FileMemoryPlanStore::GetPlanPath(const MemoryPlanKey& key, char* path, int path_size) const {
+  if (!is_directory_valid_) {
+    return false;
+  }
+  // The file name holds the whole key, so plans are only loaded for keys
+  // that match exactly.
+  const int length = snprintf(path, path_size, "%s/%016llx%016llx.tflmplan", directory_, static_cast<unsigned long long>(key.hash), static_cast<unsigned long long>(key.check));
+  return (length > 0) && (length < path_size);
+}
+
+bool FileMemoryPlanStore::LoadPlan(const MemoryPlanKey& key, int buffer_count, int* offsets) {
+  char path[kMaxPathLength + 48];
+  const int size = MemoryPlanWriter::GetSerializedSize(buffer_count);
+  if ((size > buffer_size_) || !GetPlanPath(key, path, sizeof(path))) {
+    return false;
+  }
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  const int read_size = static_cast<int>(fread(buffer_, 1, size, file));
+  fclose(file);
+  MemoryPlanReader reader;
+  if (!reader.Initialize(error_reporter_, buffer_, read_size) || (reader.GetBufferCount() != buffer_count)) {
+    return false;
+  }
+  for (int i = 0; i < buffer_count; ++i) {
+    offsets[i] = reader.GetOffset(i);
+  }
+  return true;
+}
+
+void FileMemoryPlanStore::SavePlan(const MemoryPlanKey& key, const int* offsets, const BufferRequirements* requirements, int buffer_count) {
+  char path[kMaxPathLength + 48];
+  if ((MemoryPlanWriter::GetSerializedSize(buffer_count) > buffer_size_) || !GetPlanPath(key, path, sizeof(path))) {
+    return;
+  }
+  MemoryPlanWriter writer(buffer_, buffer_size_);
+  if (!writer.Write(error_reporter_, offsets, requirements, buffer_count)) {
+    return;
+  }
+  // Write to a temporary file and rename it into place, so other processes
+  // never see a partly written plan. mkstemp() gives every writer its own
+  // file, so processes saving the same plan at once don't write into each
+  // other's.
+  char temporary_path[kMaxPathLength + 56];
+  snprintf(temporary_path, sizeof(temporary_path), "%s.XXXXXX", path);
+  const int descriptor = mkstemp(temporary_path);
+  if (descriptor < 0) {
+    return;
+  }
+  FILE* file = fdopen(descriptor, "wb");
+  if (file == nullptr) {
+    close(descriptor);
+    remove(temporary_path);
+    return;
+  }
+  const size_t written_size = writer.GetWrittenSize();
+  bool is_written = (fwrite(buffer_, 1, written_size, file) == written_size);
+  is_written = (fclose(file) == 0) && is_written;
+  if (!is_written || (rename(temporary_path, path) != 0)) {
+    remove(temporary_path);
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,66 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_FILE_MEMORY_PLAN_STORE_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_FILE_MEMORY_PLAN_STORE_H_
+
+#include "error_reporter.h"
+#include "memory_plan_cache.h"
+#include "memory_plan_serialization.h"
+
+namespace tflite {
+
+// Saves plans as files in a directory, one per key, so they can be shared
+// between processes and survive restarts. This needs a file system through
+// stdio, so like ThreadTaskRunner it's only for hosts, and is kept separate
+// from the cache itself.
+//
+// Each file is a plan in the format from memory_plan_serialization.h, named
+// after its key, so it can also be loaded with SerializedMemoryPlanner.
+class FileMemoryPlanStore : public MemoryPlanStore {
+ public:
+  // The directory must already exist. The path is copied, and anything
+  // longer than kMaxPathLength is treated as having no directory, so nothing
+  // is loaded or saved. Plans are read and written through the buffer, which
+  // must stay valid for the lifetime of the store, and plans too large for
+  // it are skipped. Files that exist but don't hold a valid plan are reported
+  // through the error reporter, and treated as missing.
+  FileMemoryPlanStore(ErrorReporter* error_reporter, const char* directory, unsigned char* buffer, int buffer_size);
+  virtual ~FileMemoryPlanStore() override {}
+
+  static constexpr int kMaxPathLength = 256;
+
+  // How many bytes the buffer needs to load and save plans of up to this
+  // many buffers.
+  static constexpr int GetBufferSize(int max_buffer_count) { return MemoryPlanWriter::GetSerializedSize(max_buffer_count); }
+
+  virtual bool LoadPlan(const MemoryPlanKey& key, int buffer_count, int* offsets) override;
+  virtual void SavePlan(const MemoryPlanKey& key, const int* offsets, const BufferRequirements* requirements, int buffer_count) override;
+
+ private:
+  // Writes the name of the file for a key into path, and returns false if it
+  // doesn't fit.
+  bool GetPlanPath(const MemoryPlanKey& key, char* path, int path_size) const;
+
+  ErrorReporter* error_reporter_;
+  char directory_[kMaxPathLength];
+  bool is_directory_valid_;
+  unsigned char* buffer_;
+  int buffer_size_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_FILE_MEMORY_PLAN_STORE_H_
@@ -15,187 +15,857 @@ limitations under the License.
 
 #include "greedy_memory_planner.h"
 
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 
 #include "reverse_sort_in_place.h"
+#include "time_overlap_mask.h"
 
 namespace tflite {
+namespace {
+
+// Plans from the cache that fail the checks are just recalculated, so the
+// reason doesn't need reporting.
+class SilentErrorReporter : public ErrorReporter {
+ public:
+  int Report(const char*, va_list) override { return 0; }
+};
+
+// Picks an offset for a buffer of wanted_size, given the active buffers in
+// ascending order of offset. The candidate offset is the end of the highest
+// buffer passed so far. Active buffers can overlap each other in memory if
+// they don't overlap each other in time, so it's not always the end of the
+// previous one. The policy is a template parameter so that each version has
+// its own tight loop, rather than branching or calling through a pointer for
+// every gap.
+template <GreedyMemoryPlanner::GapSelectionPolicy kPolicy>
+int ChooseOffset(const int* active_offsets, const int* active_ends, int active_count, int wanted_size, int wanted_alignment) {
+  int candidate_offset = 0;
+  int chosen_offset = -1;
+  int chosen_gap = 0;
+  for (int j = 0; j < active_count; ++j) {
+    // Find out how much space there is between us and the next buffer, once
+    // we've moved up to an aligned position.
+    const int aligned_offset = AlignOffset(candidate_offset, wanted_alignment);
+    const int gap = active_offsets[j] - aligned_offset;
+    if (gap >= wanted_size) {
+      if (kPolicy == GreedyMemoryPlanner::kFirstFit) {
+        // This gap is big enough, so use it!
+        return aligned_offset;
+      }
+      const bool is_better = (kPolicy == GreedyMemoryPlanner::kBestFit) ? (gap < chosen_gap) : (gap > chosen_gap);
+      if ((chosen_offset == -1) || is_better) {
+        chosen_offset = aligned_offset;
+        chosen_gap = gap;
+      }
+    }
+    // Move on past this buffer.
+    if (active_ends[j] > candidate_offset) {
+      candidate_offset = active_ends[j];
+    }
+  }
+  if (chosen_offset != -1) {
+    return chosen_offset;
+  }
+  // No gap was large enough, so go after all the active buffers.
+  return AlignOffset(candidate_offset, wanted_alignment);
+}
+
+// The first position in a sorted array with a value greater than time, or
+// count if there isn't one.
+int FindFirstPositionAfter(const int* sorted_times, int count, int time) {
+  int start = 0;
+  int end = count;
+  while (start < end) {
+    const int middle = start + ((end - start) / 2);
+    if (sorted_times[middle] <= time) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+// The position of the lowest set bit in a non-zero word.
+int FindLowestSetBit(uint32_t bits) {
+#if defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  int bit = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+}  // namespace
+
+namespace internal {
+
+int ChooseFirstFitOffset(const int* active_offsets, const int* active_ends, int active_count, int wanted_size, int wanted_alignment) {
+  return ChooseOffset<GreedyMemoryPlanner::kFirstFit>(active_offsets, active_ends, active_count, wanted_size, wanted_alignment);
+}
+
+}  // namespace internal
+
+GreedyMemoryPlanner::GreedyMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size)
+    : buffer_count_(0),
+      need_to_calculate_offsets_(true),
+      buffer_ordering_(kSizeDescending),
+      gap_selection_policy_(kFirstFit),
+      incremental_planning_(false),
+      max_incremental_growth_percent_(0),
+      planned_buffer_count_(0),
+      planned_arena_size_(0),
+      existing_offsets_changed_(false),
+      have_settings_changed_(false),
+      refinement_iteration_count_(0),
+      current_time_(nullptr),
+      max_refinement_duration_(0),
+      random_seed_(kInitialRandomSeed),
+      placement_order_count_(0),
+      alias_pair_count_(0),
+      have_alias_pairs_changed_(false),
+      use_aliases_(false),
+      plan_cache_(nullptr),
+      time_step_index_(nullptr),
+      time_step_index_size_(0),
+      use_time_step_index_(false),
+      time_step_count_(0),
+      time_step_index_word_count_(0) {
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / kPerBufferScratchSize;
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_array);
+  next_array += max_buffer_count_ * kIntsPerRequirements;
+  int** const arrays[] = {
+      &buffer_ids_in_placement_order_,
+      &sort_scratch_values_,
+      &sort_scratch_ids_,
+      &time_index_positions_,
+      &first_times_sorted_by_first_time_,
+      &placed_last_times_,
+      &placed_offsets_,
+      &placed_ends_,
+      &subtree_max_last_times_,
+      &active_offsets_,
+      &active_ends_,
+      &buffer_offsets_,
+      &previous_offsets_,
+      &best_placement_order_,
+      &alias_inputs_,
+      &alias_outputs_,
+      &preplaced_offsets_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  placement_order_keys_ = active_offsets_;
+  buffer_ids_sorted_by_first_time_ = active_ends_;
+}
 
-GreedyMemoryPlanner::GreedyMemoryPlanner() : buffer_count_(0), need_to_calculate_offsets_(true) {}
 GreedyMemoryPlanner::~GreedyMemoryPlanner() {}
 
 bool GreedyMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
-  if (buffer_count_ >= kMaxBufferCount) {
-    error_reporter->Report("Too many buffers (max is %d)", kMaxBufferCount);
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool GreedyMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
     return false;
   }
   BufferRequirements* current = &requirements_[buffer_count_];
   current->size = size;
   current->first_time_used = first_time_used;
   current->last_time_used = last_time_used;
+  current->alignment = alignment;
+  preplaced_offsets_[buffer_count_] = -1;
+  alias_inputs_[buffer_count_] = -1;
+  alias_outputs_[buffer_count_] = -1;
   ++buffer_count_;
   need_to_calculate_offsets_ = true;
   return true;
 }
 
-bool GreedyMemoryPlanner::DoesEntryOverlapInTime(const GreedyMemoryPlanner::ListEntry* entry, const int first_time_used, const int last_time_used) const {
-  const BufferRequirements* entry_requirements = &requirements_[entry->requirements_index];
-  if (entry_requirements->first_time_used > last_time_used) {
+bool GreedyMemoryPlanner::AddBufferAtOffset(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int offset) {
+  if (offset < 0) {
+    error_reporter->Report("Buffer offset %d is negative", offset);
     return false;
   }
-  if (first_time_used > entry_requirements->last_time_used) {
+  if (!AddBuffer(error_reporter, size, first_time_used, last_time_used)) {
     return false;
   }
+  preplaced_offsets_[buffer_count_ - 1] = offset;
   return true;
 }
 
-GreedyMemoryPlanner::ListEntry* GreedyMemoryPlanner::NextValidEntry(const GreedyMemoryPlanner::ListEntry* start, const int first_time_used, const int last_time_used) {
-  if ((start == nullptr) || (start->next_entry_index == -1)) {
-    return nullptr;
+bool GreedyMemoryPlanner::AddAliasPair(tflite::ErrorReporter* error_reporter, int input_buffer_index, int output_buffer_index) {
+  if ((input_buffer_index < 0) || (input_buffer_index >= buffer_count_) || (output_buffer_index < 0) || (output_buffer_index >= buffer_count_)) {
+    error_reporter->Report("Alias pair %d, %d is outside range 0 to %d", input_buffer_index, output_buffer_index, buffer_count_);
+    return false;
   }
-  ListEntry* result = nullptr;
-  ListEntry* candidate_next_entry = &buffers_sorted_by_offset_[start->next_entry_index];
-  do {
-    if (DoesEntryOverlapInTime(candidate_next_entry, first_time_used, last_time_used)) {
-      result = candidate_next_entry;
-      break;
+  if (requirements_[input_buffer_index].last_time_used != requirements_[output_buffer_index].first_time_used) {
+    error_reporter->Report("Buffer %d must be last used when buffer %d is first used to alias it", input_buffer_index, output_buffer_index);
+    return false;
+  }
+  if ((preplaced_offsets_[input_buffer_index] != -1) || (preplaced_offsets_[output_buffer_index] != -1)) {
+    error_reporter->Report("Buffers %d and %d can't be aliased, since one has a fixed offset", input_buffer_index, output_buffer_index);
+    return false;
+  }
+  // This also rules out a buffer aliasing itself, unless it's only used for
+  // one time step, and then it's the same buffer anyway.
+  if ((alias_outputs_[input_buffer_index] != -1) || (alias_inputs_[output_buffer_index] != -1) || (input_buffer_index == output_buffer_index)) {
+    error_reporter->Report("Buffers %d and %d are already in alias pairs", input_buffer_index, output_buffer_index);
+    return false;
+  }
+  // Chains are placed from the buffer at their head, so a pair that would
+  // join a chain back onto itself, leaving it without a head, can't be used.
+  for (int i = alias_outputs_[output_buffer_index]; i != -1; i = alias_outputs_[i]) {
+    if (i == input_buffer_index) {
+      error_reporter->Report("Aliasing buffer %d with %d would make a cycle", input_buffer_index, output_buffer_index);
+      return false;
     }
-    if (candidate_next_entry->next_entry_index == -1) {
+  }
+  alias_outputs_[input_buffer_index] = output_buffer_index;
+  alias_inputs_[output_buffer_index] = input_buffer_index;
+  ++alias_pair_count_;
+  have_alias_pairs_changed_ = true;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+void GreedyMemoryPlanner::BuildTimeIndex() {
+  for (int i = 0; i < buffer_count_; ++i) {
+    first_times_sorted_by_first_time_[i] = requirements_[i].first_time_used;
+    buffer_ids_sorted_by_first_time_[i] = i;
+  }
+  SortWithScratch(first_times_sorted_by_first_time_, buffer_ids_sorted_by_first_time_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+  for (int i = 0; i < buffer_count_; ++i) {
+    time_index_positions_[buffer_ids_sorted_by_first_time_[i]] = i;
+  }
+  // The time step index can only be used if every buffer's range is made of
+  // valid steps, and there's room for a bitset for each of them.
+  use_time_step_index_ = false;
+  if ((time_step_index_ != nullptr) && (buffer_count_ > 0)) {
+    bool are_times_valid = true;
+    int max_time_used = 0;
+    for (int i = 0; i < buffer_count_; ++i) {
+      const BufferRequirements& requirements = requirements_[i];
+      if ((requirements.first_time_used < 0) || (requirements.last_time_used < requirements.first_time_used)) {
+        are_times_valid = false;
+        break;
+      }
+      if (requirements.last_time_used > max_time_used) {
+        max_time_used = requirements.last_time_used;
+      }
+    }
+    // The bitset for the placed buffers goes after the one for the last step,
+    // so the count has to leave room for it as well.
+    if (are_times_valid && (max_time_used < (kMaxTimeStepCount - 1))) {
+      time_step_count_ = max_time_used + 1;
+      time_step_index_word_count_ = (buffer_count_ + 31) / 32;
+      const int64_t index_word_count = static_cast<int64_t>(time_step_count_ + 1) * time_step_index_word_count_;
+      use_time_step_index_ = (index_word_count <= (time_step_index_size_ / static_cast<int>(sizeof(uint32_t))));
+    }
+  }
+  ClearTimeIndex();
+}
+
+void GreedyMemoryPlanner::ClearTimeIndex() {
+  for (int i = 0; i < buffer_count_; ++i) {
+    placed_last_times_[i] = kNotPlacedTime;
+    subtree_max_last_times_[i] = kNotPlacedTime;
+  }
+  if (use_time_step_index_) {
+    const int index_word_count = (time_step_count_ + 1) * time_step_index_word_count_;
+    for (int i = 0; i < index_word_count; ++i) {
+      time_step_index_[i] = 0;
+    }
+  }
+}
+
+void GreedyMemoryPlanner::AddBufferToTimeIndex(int buffer_id) {
+  const int position = time_index_positions_[buffer_id];
+  const BufferRequirements* requirements = &requirements_[buffer_id];
+  const int last_time_used = requirements->last_time_used;
+  placed_last_times_[position] = last_time_used;
+  placed_offsets_[position] = buffer_offsets_[buffer_id];
+  placed_ends_[position] = buffer_offsets_[buffer_id] + requirements->size;
+  if (use_time_step_index_) {
+    const uint32_t bit = 1u << (position % 32);
+    const int word = position / 32;
+    for (int time = requirements->first_time_used; time <= last_time_used; ++time) {
+      time_step_index_[(time * time_step_index_word_count_) + word] |= bit;
+    }
+    time_step_index_[(time_step_count_ * time_step_index_word_count_) + word] |= bit;
+  }
+  // Walk down from the root to the buffer's node, updating the maximum end
+  // time of every subtree that contains it.
+  int start = 0;
+  int end = buffer_count_;
+  while (start < end) {
+    const int middle = start + ((end - start) / 2);
+    if (subtree_max_last_times_[middle] < last_time_used) {
+      subtree_max_last_times_[middle] = last_time_used;
+    }
+    if (position == middle) {
       break;
+    } else if (position < middle) {
+      end = middle;
+    } else {
+      start = middle + 1;
     }
-    candidate_next_entry = &buffers_sorted_by_offset_[candidate_next_entry->next_entry_index];
-  } while (true);
-  return result;
+  }
 }
 
-void GreedyMemoryPlanner::CalculateOffsetsIfNeeded() {
-  if (!need_to_calculate_offsets_ || (buffer_count_ == 0)) {
-    return;
+void GreedyMemoryPlanner::CollectActiveBuffers(int start, int end, int first_time_used, int last_time_used, int* active_count) {
+  while (start < end) {
+    if ((end - start) <= kOverlapMaskScanSize) {
+      // Check the whole range at once. Buffers that haven't been placed have
+      // a last time before any real one, so they're never included.
+      uint32_t mask = CalculateTimeOverlapMask(&first_times_sorted_by_first_time_[start], &placed_last_times_[start], end - start, first_time_used, last_time_used);
+      for (int position = start; mask != 0; ++position, mask >>= 1) {
+        if ((mask & 1) != 0) {
+          active_offsets_[*active_count] = placed_offsets_[position];
+          active_ends_[*active_count] = placed_ends_[position];
+          ++(*active_count);
+        }
+      }
+      return;
+    }
+    const int middle = start + ((end - start) / 2);
+    // If nothing placed in this subtree is still in use by the time we need
+    // the buffer, none of it can overlap.
+    if (subtree_max_last_times_[middle] < first_time_used) {
+      return;
+    }
+    CollectActiveBuffers(start, middle, first_time_used, last_time_used, active_count);
+    // Everything from the middle onwards starts at or after the middle, so if
+    // that's after our range none of them can overlap either.
+    if (first_times_sorted_by_first_time_[middle] > last_time_used) {
+      return;
+    }
+    if (placed_last_times_[middle] >= first_time_used) {
+      active_offsets_[*active_count] = placed_offsets_[middle];
+      active_ends_[*active_count] = placed_ends_[middle];
+      ++(*active_count);
+    }
+    start = middle + 1;
   }
-  need_to_calculate_offsets_ = false;
+}
 
+int GreedyMemoryPlanner::CollectActiveBuffersFromTimeSteps(int first_time_used, int last_time_used) {
+  // A buffer overlaps the range if it's in use at the first step, or if it
+  // starts later in the range. The buffers that start later are a run of
+  // positions in the time index, so they're found by masking the bitset of
+  // placed buffers, and anything from the end of that run onwards starts too
+  // late to overlap at all.
+  const int run_start = FindFirstPositionAfter(first_times_sorted_by_first_time_, buffer_count_, first_time_used);
+  const int run_end = FindFirstPositionAfter(first_times_sorted_by_first_time_, buffer_count_, last_time_used);
+  const uint32_t* in_use_at_first_time = &time_step_index_[first_time_used * time_step_index_word_count_];
+  const uint32_t* placed = &time_step_index_[time_step_count_ * time_step_index_word_count_];
+  const int end_word = (run_end + 31) / 32;
+  int active_count = 0;
+  for (int word = 0; word < end_word; ++word) {
+    const int word_start = word * 32;
+    uint32_t run_mask = 0;
+    if ((run_start < (word_start + 32)) && (run_end > word_start)) {
+      const int low_bit = (run_start > word_start) ? (run_start - word_start) : 0;
+      const int high_bit = (run_end < (word_start + 32)) ? (run_end - word_start) : 32;
+      const uint32_t below_high = (high_bit == 32) ? 0xffffffffu : ((1u << high_bit) - 1);
+      run_mask = below_high & ~((1u << low_bit) - 1);
+    }
+    uint32_t bits = in_use_at_first_time[word] | (placed[word] & run_mask);
+    while (bits != 0) {
+      const int position = word_start + FindLowestSetBit(bits);
+      bits &= bits - 1;
+      active_offsets_[active_count] = placed_offsets_[position];
+      active_ends_[active_count] = placed_ends_[position];
+      ++active_count;
+    }
+  }
+  return active_count;
+}
+
+int GreedyMemoryPlanner::FindActiveBuffers(int first_time_used, int last_time_used) {
+  int active_count = 0;
+  if (use_time_step_index_) {
+    active_count = CollectActiveBuffersFromTimeSteps(first_time_used, last_time_used);
+  } else {
+    CollectActiveBuffers(0, buffer_count_, first_time_used, last_time_used, &active_count);
+  }
+  // The sort carries the ends along with the offsets, in place of ids.
+  SortWithScratch(active_offsets_, active_ends_, active_count, sort_scratch_values_, sort_scratch_ids_);
+  return active_count;
+}
+
+int GreedyMemoryPlanner::GetPlacementOrderKey(const BufferRequirements& requirements) const {
+  const int lifetime = (requirements.last_time_used - requirements.first_time_used) + 1;
+  switch (buffer_ordering_) {
+    case kLifetimeDescending:
+      return lifetime;
+    case kAreaDescending: {
+      // Large buffers with long lifetimes can overflow an int, but they'll
+      // still be placed first if the area is clamped.
+      const int64_t area = static_cast<int64_t>(requirements.size) * lifetime;
+      return (area > kMaxPlacementOrderKey) ? kMaxPlacementOrderKey : static_cast<int>(area);
+    }
+    case kFirstUseAscending:
+      return requirements.first_time_used;
+    case kSizeDescending:
+    default:
+      return requirements.size;
+  }
+}
+
+void GreedyMemoryPlanner::PlaceBuffers(int first_buffer_id) {
   // Start off by ordering the buffers in descending order of size.
   // This helps find a more compact layout. Intuitively, you can think
   // about putting the large buffers in place first, and then the
   // smaller buffers can fit in the gaps, rather than fragmenting the
   // gaps with small buffers at the beginning.
-  for (int i = 0; i < buffer_count_; ++i) {
-    buffer_sizes_sorted_by_size_[i] = requirements_[i].size;
-    buffer_ids_sorted_by_size_[i] = i;
-  }
-  // This sorting algorithm is naive, and may end up taking a very long time
-  // with hundreds of buffers.
-  ReverseSortInPlace(buffer_sizes_sorted_by_size_, buffer_ids_sorted_by_size_, buffer_count_);
-
-  // Put the largest buffer at offset zero to start the process.
-  ListEntry* first_entry = &buffers_sorted_by_offset_[0];
-  first_entry->offset = 0;
-  first_entry->requirements_index = buffer_ids_sorted_by_size_[0];
-  first_entry->next_entry_index = -1;
-  next_free_entry_ = 1;
-
-  // Work through the rest of the buffers to find a good gap to place each one.
-  for (int i = 1; i < buffer_count_; ++i) {
+  // Buffers that reuse another buffer's memory are placed along with it, so
+  // only the first buffer of each alias group goes in the order.
+  int place_count = 0;
+  for (int buffer_id = first_buffer_id; buffer_id < buffer_count_; ++buffer_id) {
+    if ((use_aliases_ && (alias_inputs_[buffer_id] != -1)) || (preplaced_offsets_[buffer_id] != -1)) {
+      continue;
+    }
+    BufferRequirements requirements;
+    GetPlacementRequirements(buffer_id, &requirements);
+    placement_order_keys_[place_count] = GetPlacementOrderKey(requirements);
+    buffer_ids_in_placement_order_[place_count] = buffer_id;
+    ++place_count;
+  }
+  placement_order_count_ = place_count;
+  // The sort is stable, so buffers with equal keys stay in the order they
+  // were added, which keeps plans reproducible.
+  if (buffer_ordering_ == kFirstUseAscending) {
+    SortWithScratch(placement_order_keys_, buffer_ids_in_placement_order_, place_count, sort_scratch_values_, sort_scratch_ids_);
+  } else {
+    ReverseSortWithScratch(placement_order_keys_, buffer_ids_in_placement_order_, place_count, sort_scratch_values_, sort_scratch_ids_);
+  }
+  PlaceBuffersInOrder(0, place_count);
+}
+
+void GreedyMemoryPlanner::PlaceBuffersInOrder(int start, int end) {
+  // Work through the buffers to find a good gap to place each one.
+  for (int i = start; i < end; ++i) {
     // The id is the order the buffer was originally added by the client.
-    const int buffer_id = buffer_ids_sorted_by_size_[i];
+    const int buffer_id = buffer_ids_in_placement_order_[i];
     // Look at what size and time range the buffer needs to be active.
-    BufferRequirements* wanted_requirements = &requirements_[buffer_id];
-    const int wanted_size = wanted_requirements->size;
-    const int wanted_first_time_used = wanted_requirements->first_time_used;
-    const int wanted_last_time_used = wanted_requirements->last_time_used;
-    // Find the first buffer that's active in our time range. All placed
-    // buffers are stored in the order of their starting position in the arena
-    // so that it's easy to find the next buffer in memory, and so the gap.
-    // The candidate_entry variable holds the buffer that we're considering
-    // placing the current buffer after.
-    ListEntry* candidate_entry;
-    if (DoesEntryOverlapInTime(first_entry, wanted_first_time_used, wanted_last_time_used)) {
-      candidate_entry = first_entry;
-    } else {
-      candidate_entry = NextValidEntry(first_entry, wanted_first_time_used, wanted_last_time_used);
-    }
-    // Loop through the offset-ordered list of buffers, looking for gaps.
-    while (true) {
-      // Find out what the next active buffer is.
-      ListEntry* next_entry = NextValidEntry(candidate_entry, wanted_first_time_used, wanted_last_time_used);
-      if (next_entry == nullptr) {
-        // We're at the end of the list, so we can always append the buffer
-        // here.
+    BufferRequirements wanted_requirements;
+    GetPlacementRequirements(buffer_id, &wanted_requirements);
+    const int wanted_size = wanted_requirements.size;
+    const int wanted_alignment = wanted_requirements.alignment;
+    // Find all the buffers already placed that are active in our time range,
+    // in the order of their starting position in the arena, so it's easy to
+    // find the gaps between them.
+    const int active_count = FindActiveBuffers(wanted_requirements.first_time_used, wanted_requirements.last_time_used);
+    int offset;
+    switch (gap_selection_policy_) {
+      case kBestFit:
+        offset = ChooseOffset<kBestFit>(active_offsets_, active_ends_, active_count, wanted_size, wanted_alignment);
         break;
-      }
-      BufferRequirements* candidate_requirements = &requirements_[candidate_entry->requirements_index];
-      // Find out how much space there is between us and the next buffer.
-      const int gap = next_entry->offset - (candidate_entry->offset + candidate_requirements->size);
-      if (gap >= wanted_size) {
-        // This entry has a big enough gap between it and the next, so
-        // use it!
+      case kWorstFit:
+        offset = ChooseOffset<kWorstFit>(active_offsets_, active_ends_, active_count, wanted_size, wanted_alignment);
+        break;
+      case kFirstFit:
+      default:
+        offset = ChooseOffset<kFirstFit>(active_offsets_, active_ends_, active_count, wanted_size, wanted_alignment);
         break;
-      }
-      // The gap wasn't big enough, so move on to another candidate.
-      candidate_entry = next_entry;
     }
-    // At this point, we've either found a gap (possibly at the end of the
-    // list) and want to place the buffer there, or there are no other active
-    // buffers in this time range and so we can put it at offset zero.
-    int offset;
-    if (candidate_entry != nullptr) {
-      BufferRequirements* candidate_requirements = &requirements_[candidate_entry->requirements_index];
-      offset = (candidate_entry->offset + candidate_requirements->size);
-    } else {
-      offset = 0;
-    }
-    // Record the buffer's offset in our plan.
-    buffer_offsets_[buffer_id] = offset;
-    // Add the newly-placed buffer to our offset-ordered list, so that
-    // subsequent passes can fit in their buffers around it.
-    ListEntry* new_entry = &buffers_sorted_by_offset_[next_free_entry_];
-    new_entry->offset = offset;
-    new_entry->requirements_index = buffer_id;
-    const int new_entry_index = next_free_entry_;
-    ++next_free_entry_;
-    ListEntry* current_entry = first_entry;
-    // Make sure that we insert the buffer at the correct place in the ordered
-    // list.
-    while (true) {
-      const int next_entry_index = current_entry->next_entry_index;
-      if (next_entry_index == -1) {
-        // We're at the end of the list, so just add the new entry here.
-        current_entry->next_entry_index = new_entry_index;
-        new_entry->next_entry_index = -1;        
+    RecordPlacement(buffer_id, offset);
+  }
+}
+
+void GreedyMemoryPlanner::GetPlacementRequirements(int buffer_id, BufferRequirements* requirements) const {
+  *requirements = requirements_[buffer_id];
+  if (!use_aliases_) {
+    return;
+  }
+  // The group needs room for its largest buffer from when the first one
+  // starts to when the last one finishes. Alignments are all powers of two,
+  // so the largest is a multiple of the others.
+  for (int member = alias_outputs_[buffer_id]; member != -1; member = alias_outputs_[member]) {
+    const BufferRequirements* member_requirements = &requirements_[member];
+    if (member_requirements->size > requirements->size) {
+      requirements->size = member_requirements->size;
+    }
+    if (member_requirements->last_time_used > requirements->last_time_used) {
+      requirements->last_time_used = member_requirements->last_time_used;
+    }
+    if (member_requirements->alignment > requirements->alignment) {
+      requirements->alignment = member_requirements->alignment;
+    }
+  }
+}
+
+void GreedyMemoryPlanner::RecordPlacement(int buffer_id, int offset) {
+  // Record the buffer's offset in our plan, and add it to the time index so
+  // that subsequent passes can fit in their buffers around it. Each buffer in
+  // an alias group is indexed with its own size and times, so later buffers
+  // can still use the space above smaller ones.
+  buffer_offsets_[buffer_id] = offset;
+  AddBufferToTimeIndex(buffer_id);
+  if (!use_aliases_) {
+    return;
+  }
+  for (int member = alias_outputs_[buffer_id]; member != -1; member = alias_outputs_[member]) {
+    buffer_offsets_[member] = offset;
+    AddBufferToTimeIndex(member);
+  }
+}
+
+void GreedyMemoryPlanner::AddPreplacedBuffers() {
+  for (int buffer_id = 0; buffer_id < buffer_count_; ++buffer_id) {
+    if (preplaced_offsets_[buffer_id] != -1) {
+      buffer_offsets_[buffer_id] = preplaced_offsets_[buffer_id];
+      AddBufferToTimeIndex(buffer_id);
+    }
+  }
+}
+
+void GreedyMemoryPlanner::ReplaceBuffersFrom(int start) {
+  ClearTimeIndex();
+  AddPreplacedBuffers();
+  for (int i = 0; i < start; ++i) {
+    const int buffer_id = buffer_ids_in_placement_order_[i];
+    RecordPlacement(buffer_id, buffer_offsets_[buffer_id]);
+  }
+  PlaceBuffersInOrder(start, placement_order_count_);
+}
+
+int GreedyMemoryPlanner::NextRandom(int range) {
+  random_seed_ = (random_seed_ * 1103515245) + 12345;
+  return (random_seed_ >> 8) % range;
+}
+
+void GreedyMemoryPlanner::RefinePlacementOrder() {
+  if ((refinement_iteration_count_ <= 0) || (placement_order_count_ < 2)) {
+    return;
+  }
+  random_seed_ = kInitialRandomSeed;
+  int current_arena_size = CalculateArenaSize();
+  int best_arena_size = current_arena_size;
+  for (int i = 0; i < placement_order_count_; ++i) {
+    best_placement_order_[i] = buffer_ids_in_placement_order_[i];
+  }
+  const float initial_temperature = current_arena_size * kInitialTemperatureFraction;
+  const int64_t start_time = (current_time_ != nullptr) ? current_time_() : 0;
+  float time_remaining = 1.0f;
+  for (int iteration = 0; iteration < refinement_iteration_count_; ++iteration) {
+    if ((current_time_ != nullptr) && ((iteration % kTimeCheckInterval) == 0)) {
+      const int64_t elapsed = current_time_() - start_time;
+      if (elapsed >= max_refinement_duration_) {
         break;
       }
-      ListEntry* next_entry = &buffers_sorted_by_offset_[next_entry_index];
-      if (next_entry->offset > offset) {
-        // We're at the right spot to do an insertion and retain the sorting
-        // order, so place the new entry here.
-        new_entry->next_entry_index = current_entry->next_entry_index;
-        current_entry->next_entry_index = new_entry_index;
-        break;
+      time_remaining = 1.0f - (static_cast<float>(elapsed) / max_refinement_duration_);
+    }
+    // The search cools down as whichever budget is closer to running out
+    // gets used up.
+    float remaining = 1.0f - (static_cast<float>(iteration) / refinement_iteration_count_);
+    if (time_remaining < remaining) {
+      remaining = time_remaining;
+    }
+    const float temperature = initial_temperature * remaining;
+
+    const int position = NextRandom(placement_order_count_ - 1);
+    int* swapped = &buffer_ids_in_placement_order_[position];
+    const int first_id = swapped[0];
+    swapped[0] = swapped[1];
+    swapped[1] = first_id;
+    ReplaceBuffersFrom(position);
+    const int arena_size = CalculateArenaSize();
+    const int increase = arena_size - current_arena_size;
+    bool keep_change = (increase <= 0);
+    if (!keep_change && (temperature > 0.0f)) {
+      const float probability = std::exp(-increase / temperature);
+      keep_change = (NextRandom(kRandomRange) < (probability * kRandomRange));
+    }
+    if (keep_change) {
+      current_arena_size = arena_size;
+      if (arena_size < best_arena_size) {
+        best_arena_size = arena_size;
+        for (int i = 0; i < placement_order_count_; ++i) {
+          best_placement_order_[i] = buffer_ids_in_placement_order_[i];
+        }
       }
-      current_entry = next_entry;
+    } else {
+      // Placement is deterministic, so swapping back and placing again
+      // restores the previous plan.
+      swapped[1] = swapped[0];
+      swapped[0] = first_id;
+      ReplaceBuffersFrom(position);
     }
   }
-}
 
-int GreedyMemoryPlanner::GetMaximumMemorySize() {
-  CalculateOffsetsIfNeeded();
-  if (buffer_count_ == 0) {
-    return 0;
+  if (current_arena_size != best_arena_size) {
+    for (int i = 0; i < placement_order_count_; ++i) {
+      buffer_ids_in_placement_order_[i] = best_placement_order_[i];
+    }
+    ReplaceBuffersFrom(0);
   }
-  ListEntry* entry = &buffers_sorted_by_offset_[0];
+}
+
+int GreedyMemoryPlanner::CalculateArenaSize() const {
   int max_size = 0;
-  while (entry) {
-    BufferRequirements* requirements = &requirements_[entry->requirements_index];
-    const int current_size = entry->offset + requirements->size;
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int current_size = buffer_offsets_[i] + requirements_[i].size;
     if (current_size > max_size) {
       max_size = current_size;
     }
-    if (entry->next_entry_index == -1) {
+  }
+  return max_size;
+}
+
+bool GreedyMemoryPlanner::HavePreviousOffsetsMoved() const {
+  for (int i = 0; i < planned_buffer_count_; ++i) {
+    if (buffer_offsets_[i] != previous_offsets_[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void GreedyMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_ || (buffer_count_ == 0)) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  existing_offsets_changed_ = false;
+  const bool have_aliases_changed = have_alias_pairs_changed_;
+  have_alias_pairs_changed_ = false;
+  const bool have_settings_changed = have_settings_changed_;
+  have_settings_changed_ = false;
+
+  // Try fitting just the new buffers around the existing plan first, and keep
+  // the result if the arena hasn't grown by too much. New alias pairs could
+  // tie new buffers to old offsets, new settings could change where the old
+  // buffers belong, and new fixed buffers could land on top of old ones, so
+  // they all need a full plan.
+  bool are_new_buffers_fixed = false;
+  for (int i = planned_buffer_count_; i < buffer_count_; ++i) {
+    if (preplaced_offsets_[i] != -1) {
+      are_new_buffers_fixed = true;
       break;
     }
-    entry = &buffers_sorted_by_offset_[entry->next_entry_index];
   }
-  return max_size;
+  if (incremental_planning_ && (planned_buffer_count_ > 0) && (buffer_count_ > planned_buffer_count_) && !have_aliases_changed && !have_settings_changed && !are_new_buffers_fixed) {
+    BuildTimeIndex();
+    for (int i = 0; i < planned_buffer_count_; ++i) {
+      AddBufferToTimeIndex(i);
+    }
+    PlaceBuffers(planned_buffer_count_);
+    const int arena_size = CalculateArenaSize();
+    const int64_t growth_limit = (static_cast<int64_t>(planned_arena_size_) * (100 + max_incremental_growth_percent_)) / 100;
+    if (arena_size <= growth_limit) {
+      planned_buffer_count_ = buffer_count_;
+      planned_arena_size_ = arena_size;
+      return;
+    }
+  }
+
+  for (int i = 0; i < planned_buffer_count_; ++i) {
+    previous_offsets_[i] = buffer_offsets_[i];
+  }
+  const bool use_cache = (plan_cache_ != nullptr) && (current_time_ == nullptr);
+  MemoryPlanKey plan_key;
+  if (use_cache) {
+    plan_key = CalculatePlanKey();
+    if (plan_cache_->FindPlan(plan_key, buffer_count_, buffer_offsets_) && AreOffsetsConsistent()) {
+      existing_offsets_changed_ = HavePreviousOffsetsMoved();
+      planned_buffer_count_ = buffer_count_;
+      planned_arena_size_ = CalculateArenaSize();
+      return;
+    }
+  }
+  BuildTimeIndex();
+  PlanAllBuffers(false);
+  // Sharing memory between aliased buffers means each group is held for its
+  // whole lifetime at its largest size, which can use more memory than
+  // placing them separately, so only keep the aliased plan if it's smaller.
+  if (alias_pair_count_ > 0) {
+    const int unaliased_arena_size = CalculateArenaSize();
+    PlanAllBuffers(true);
+    if (CalculateArenaSize() >= unaliased_arena_size) {
+      PlanAllBuffers(false);
+    }
+  }
+  existing_offsets_changed_ = HavePreviousOffsetsMoved();
+  planned_buffer_count_ = buffer_count_;
+  planned_arena_size_ = CalculateArenaSize();
+  if (use_cache) {
+    plan_cache_->AddPlan(plan_key, buffer_offsets_, requirements_, buffer_count_);
+  }
+}
+
+MemoryPlanKey GreedyMemoryPlanner::CalculatePlanKey() const {
+  MemoryPlanHasher hasher;
+  hasher.AddInt(kPlanCacheKind);
+  hasher.AddInt(buffer_ordering_);
+  hasher.AddInt(gap_selection_policy_);
+  hasher.AddInt(refinement_iteration_count_);
+  hasher.AddInt(buffer_count_);
+  for (int i = 0; i < buffer_count_; ++i) {
+    const BufferRequirements* requirements = &requirements_[i];
+    hasher.AddInt(requirements->size);
+    hasher.AddInt(requirements->first_time_used);
+    hasher.AddInt(requirements->last_time_used);
+    hasher.AddInt(requirements->alignment);
+    hasher.AddInt(preplaced_offsets_[i]);
+    hasher.AddInt(alias_outputs_[i]);
+  }
+  return hasher.GetKey();
+}
+
+bool GreedyMemoryPlanner::AreOffsetsConsistent() const {
+  for (int i = 0; i < buffer_count_; ++i) {
+    if ((preplaced_offsets_[i] != -1) && (buffer_offsets_[i] != preplaced_offsets_[i])) {
+      return false;
+    }
+  }
+  // The working arrays are all rebuilt before they're next used, so they can
+  // hold the requirements to check and the verifier's scratch memory. An
+  // aliased buffer can share its input's memory on the step where it takes
+  // over, if the plan put them at the same offset, so that step is left out
+  // of its lifetime the same way GetMemoryLowerBound() does.
+  BufferRequirements* verify_requirements = reinterpret_cast<BufferRequirements*>(buffer_ids_in_placement_order_);
+  int* verify_scratch = buffer_ids_in_placement_order_ + (buffer_count_ * kIntsPerRequirements);
+  for (int i = 0; i < buffer_count_; ++i) {
+    verify_requirements[i] = requirements_[i];
+    const int alias_input = alias_inputs_[i];
+    if ((alias_input != -1) && (buffer_offsets_[i] == buffer_offsets_[alias_input])) {
+      BufferRequirements* current = &verify_requirements[i];
+      if (current->first_time_used == current->last_time_used) {
+        current->size = 0;
+      } else {
+        ++current->first_time_used;
+      }
+    }
+  }
+  SilentErrorReporter error_reporter;
+  return VerifyMemoryPlan(&error_reporter, verify_requirements, buffer_offsets_, buffer_count_, CalculateArenaSize(), verify_scratch);
+}
+
+void GreedyMemoryPlanner::PlanAllBuffers(bool use_aliases) {
+  use_aliases_ = use_aliases;
+  ClearTimeIndex();
+  AddPreplacedBuffers();
+  PlaceBuffers(0);
+  RefinePlacementOrder();
+}
+
+int GreedyMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return CalculateArenaSize();
+}
+
+void GreedyMemoryPlanner::SetBufferOrdering(BufferOrdering ordering) {
+  buffer_ordering_ = ordering;
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+void GreedyMemoryPlanner::SetGapSelectionPolicy(GapSelectionPolicy policy) {
+  gap_selection_policy_ = policy;
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+void GreedyMemoryPlanner::SetIncrementalPlanning(bool enabled, int max_growth_percent) {
+  incremental_planning_ = enabled;
+  max_incremental_growth_percent_ = max_growth_percent;
+}
+
+void GreedyMemoryPlanner::SetRefinementIterations(int max_iterations) {
+  refinement_iteration_count_ = max_iterations;
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+void GreedyMemoryPlanner::SetRefinementTimeBudget(int64_t (*current_time)(), int64_t max_duration) {
+  current_time_ = current_time;
+  max_refinement_duration_ = max_duration;
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+void GreedyMemoryPlanner::SetPlanCache(MemoryPlanCache* cache) {
+  plan_cache_ = cache;
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+void GreedyMemoryPlanner::SetTimeStepIndex(unsigned char* index_buffer, int index_buffer_size) {
+  time_step_index_ = nullptr;
+  time_step_index_size_ = 0;
+  if (index_buffer != nullptr) {
+    const int misalignment = reinterpret_cast<uintptr_t>(index_buffer) % alignof(uint32_t);
+    const int alignment_padding = (misalignment == 0) ? 0 : (alignof(uint32_t) - misalignment);
+    if (index_buffer_size > alignment_padding) {
+      time_step_index_ = reinterpret_cast<uint32_t*>(index_buffer + alignment_padding);
+      time_step_index_size_ = index_buffer_size - alignment_padding;
+    }
+  }
+  have_settings_changed_ = true;
+  need_to_calculate_offsets_ = true;
+}
+
+bool GreedyMemoryPlanner::HaveExistingOffsetsChanged() {
+  CalculateOffsetsIfNeeded();
+  return existing_offsets_changed_;
+}
+
+int GreedyMemoryPlanner::GetMemoryLowerBound() {
+  // Every working array is rebuilt when a plan is calculated, so once there's
+  // an up to date plan they're free to use.
+  CalculateOffsetsIfNeeded();
+  if (alias_pair_count_ == 0) {
+    return CalculateMemoryLowerBound(requirements_, buffer_count_, buffer_ids_in_placement_order_);
+  }
+  // Aliased buffers can share memory on the step where one hands over to the
+  // other, so leave that step out of the later buffer's lifetime. If it's
+  // only used on that step, it needs no memory of its own at all.
+  BufferRequirements* bound_requirements = reinterpret_cast<BufferRequirements*>(buffer_ids_in_placement_order_);
+  int* bound_scratch = buffer_ids_in_placement_order_ + (buffer_count_ * kIntsPerRequirements);
+  for (int i = 0; i < buffer_count_; ++i) {
+    bound_requirements[i] = requirements_[i];
+    if (alias_inputs_[i] != -1) {
+      BufferRequirements* current = &bound_requirements[i];
+      if (current->first_time_used == current->last_time_used) {
+        current->size = 0;
+      } else {
+        ++current->first_time_used;
+      }
+    }
+  }
+  return CalculateMemoryLowerBound(bound_requirements, buffer_count_, bound_scratch);
+}
+
+int GreedyMemoryPlanner::GetOptimalityGap() {
+  return GetMaximumMemorySize() - GetMemoryLowerBound();
+}
+
+float GreedyMemoryPlanner::GetOptimalityRatio() {
+  return CalculateOptimalityRatio(GetMaximumMemorySize(), GetMemoryLowerBound());
 }
 
 void GreedyMemoryPlanner::PrintMemoryPlan(ErrorReporter* error_reporter) {
@@ -251,6 +921,7 @@ bool GreedyMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_report
       error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
       return false;
   }
+  CalculateOffsetsIfNeeded();
   *offset = buffer_offsets_[buffer_index];
   return true;
 }
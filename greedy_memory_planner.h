@@ -16,6 +16,11 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_MEMORY_PLANNER_H_
 #define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_MEMORY_PLANNER_H_
 
+#include <cstdint>
+
+#include "memory_lower_bound.h"
+#include "memory_plan_cache.h"
+#include "memory_plan_verifier.h"
 #include "memory_planner.h"
 
 namespace tflite {
@@ -28,25 +33,96 @@ namespace tflite {
 //  - When a function like GetOffsetForBuffer() is called, the
 //    CalculateOffsetsIfNeeded() method is invoked.
 //  - If an up to date plan is not already present, one will be calculated.
-//  - The buffers are sorted in descending order of size.
-//  - The largest buffer is placed at offset zero.
-//  - The rest of the buffers are looped through in descending size order.
-//  - The other buffers that need to be in memory at the same time are found.
+//  - Any buffers with fixed offsets from AddBufferAtOffset() are put in
+//    place first.
+//  - The other buffers are sorted in descending order of size, or another
+//    order chosen through SetBufferOrdering().
+//  - The buffers are looped through in that order.
+//  - The other buffers that have already been placed and need to be in memory
+//    at the same time are found, using an index over their time ranges, or
+//    optionally bitsets for each time step. See SetTimeStepIndex().
 //  - The first gap between active buffers that the current buffer fits into 
-//    will be used.
+//    will be used, starting from offset zero, with the start of each gap
+//    rounded up to the buffer's alignment. SetGapSelectionPolicy() can
+//    change this to the smallest or largest gap that fits instead.
 //  - If no large-enough gap is found, the current buffer is placed after the
 //    last active buffer.
 //  - This continues until all buffers are placed, and the offsets stored.
+//  - If some buffers can share memory, declared through AddAliasPair(), the
+//    plan is also made with each group of them placed as one buffer, and
+//    whichever plan is smaller is kept.
+//  - Optionally, a local search then tries swapping neighbours in the
+//    placement order to find a smaller arena. See SetRefinementIterations().
 //
 // This is not guaranteed to produce the best placement, since that's an
 // NP-Complete problem, but in practice it should produce one that's decent.
+//
+// No memory is allocated by the planner itself. Instead the client passes in
+// a scratch buffer that holds all of the working arrays, and the number of
+// buffers that can be planned depends on its size. Use GetScratchBufferSize()
+// to find out how large it needs to be for a given number of buffers.
 class GreedyMemoryPlanner : public MemoryPlanner {
  public:
-  GreedyMemoryPlanner();
+  // The scratch buffer must stay valid for the lifetime of the planner, but
+  // isn't owned by it, so it can be stack or globally allocated on devices
+  // without dynamic memory. Once you're done with the planner, the memory can
+  // be reused as long as you've copied out the offsets you need.
+  GreedyMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
   virtual ~GreedyMemoryPlanner() override;
 
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers. This includes room to align the working arrays, so any pointer
+  // can be used for the scratch buffer. With 32-bit ints each buffer costs 84
+  // bytes: 16 for its requirements, 44 for the arrays that are only used
+  // while planning, 4 for its offset, and 20 for the offset it had before
+  // the last full plan, the best order found by refinement, its alias pair
+  // and its fixed offset. Those last 20 bytes are reserved whether or not
+  // incremental planning, refinement, alias pairs or fixed offsets are used,
+  // so that any of them can be turned on after the planner is built.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * kPerBufferScratchSize) + (kScratchAlignment - 1);
+  }
+
+  // The most buffers that can be added with the scratch buffer given.
+  int GetMaxBufferCount() const { return max_buffer_count_; }
+
+  // How to choose between the gaps an active buffer could be placed in.
+  enum GapSelectionPolicy {
+    // Use the lowest gap that's large enough. This is the default.
+    kFirstFit,
+    // Use the smallest gap that's large enough, which leaves larger gaps free
+    // for later buffers and can reduce fragmentation.
+    kBestFit,
+    // Use the largest gap, leaving the biggest possible space after it.
+    kWorstFit,
+  };
+
+  // The order buffers are placed in. Larger buffers going first usually gives
+  // the most compact layout, but on some graphs the other orders do better.
+  enum BufferOrdering {
+    // Descending order of size. This is the default.
+    kSizeDescending,
+    // Descending order of how many time steps the buffer is active for.
+    kLifetimeDescending,
+    // Descending order of size multiplied by lifetime.
+    kAreaDescending,
+    // Ascending order of the time the buffer is first used.
+    kFirstUseAscending,
+  };
+  static constexpr int kBufferOrderingCount = 4;
+
+  // Changes the order that buffers are placed in. Buffers that compare equal
+  // are always placed in the order they were added.
+  void SetBufferOrdering(BufferOrdering ordering);
+
+  // Changes how gaps are chosen. Only gaps between active buffers are
+  // considered, so if none are large enough the buffer is still placed after
+  // the highest active buffer.
+  void SetGapSelectionPolicy(GapSelectionPolicy policy);
+
   // Record details of a buffer we want to place.
   virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
 
   // Returns the high-water mark of used memory. This is the minimum size of a
   // memory arena you'd need to allocate to hold these buffers.
@@ -58,56 +134,357 @@ class GreedyMemoryPlanner : public MemoryPlanner {
   // Where a given buffer should be placed in the memory arena.
   virtual bool GetOffsetForBuffer(ErrorReporter* error_reporter, int buffer_index, int* offset) override;
 
+  // The peak total size of buffers active at the same time. No plan can use
+  // a smaller arena than this. Alias pairs are taken into account by only
+  // counting the larger buffer at the time one hands over to the other.
+  int GetMemoryLowerBound();
+
+  // How many bytes larger the arena is than GetMemoryLowerBound(), and how
+  // many times larger as a ratio. These show how much a more expensive
+  // planner could save at most.
+  int GetOptimalityGap();
+  float GetOptimalityRatio();
+
+  // Adds a buffer that has to be at a particular offset, like a DMA target or
+  // memory shared with another processor. Other buffers are placed around
+  // it, and the arena will be large enough to hold it. It's up to the client
+  // to make sure fixed buffers that are active at the same time don't
+  // overlap each other. Adding one after a plan has been made always leads
+  // to a full plan, even with incremental planning, so that the buffers
+  // already placed can move out of its way.
+  bool AddBufferAtOffset(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int offset);
+
+  // Declares that the output buffer can reuse the input buffer's memory, as
+  // an element-wise op like ReLU can write its result over its input. Neither
+  // can have a fixed offset. The input must be last used at the time the
+  // output is first used, and each buffer can only be the input of one pair
+  // and the output of one pair, so pairs link up into chains. Pairs that
+  // would join a chain into a cycle are rejected. The planner tries placing
+  // every chain as a single allocation, sized for its largest buffer and
+  // lasting from the first buffer's first use to the last one's last use,
+  // and keeps that plan if it needs a smaller arena than placing the buffers
+  // separately.
+  bool AddAliasPair(ErrorReporter* error_reporter, int input_buffer_index, int output_buffer_index);
+
   // Prints an ascii-art diagram of the buffer layout plan.
   void PrintMemoryPlan(ErrorReporter* error_reporter);
 
-  // Used to store a list of buffers ordered by their offset.
-  struct ListEntry {
-    int offset;
-    int requirements_index;
-    int next_entry_index;
-  };
+  // By default, adding buffers after a plan has been calculated means the
+  // next query makes a completely new plan, which may move buffers that
+  // already had offsets. With incremental planning enabled, only the new
+  // buffers are placed, fitting them into gaps around the existing plan
+  // without moving anything else. If that grows the arena by more than
+  // max_growth_percent over the previous plan, or any other setting has
+  // changed since it was made, everything is planned again.
+  void SetIncrementalPlanning(bool enabled, int max_growth_percent);
+
+  // After each full plan, spend up to this many iterations trying to improve
+  // it. Each one swaps two buffers that are next to each other in the
+  // placement order, and places everything from that point on again. Changes
+  // that shrink the arena are always kept, and ones that grow it are
+  // sometimes kept too, less often as the search goes on, so that it can
+  // escape from local minima (simulated annealing). The smallest plan seen is
+  // the one that's used. Iterations cost up to a full placement each, so this
+  // is meant for offline planning. The default of zero disables refinement.
+  // The search is seeded with a fixed value, so results are reproducible.
+  void SetRefinementIterations(int max_iterations);
+
+  // Also stops refinement once current_time() has advanced by max_duration.
+  // The units are whatever current_time() returns, so on devices this can be
+  // a cycle counter. A null current_time removes the limit, which is the
+  // default.
+  void SetRefinementTimeBudget(int64_t (*current_time)(), int64_t max_duration);
+
+  // Looks up full plans in a cache before calculating them, and adds them to
+  // it afterwards. The key covers every buffer's requirements, fixed offset
+  // and alias pair, as well as the ordering, gap policy and refinement
+  // settings, so a plan is only reused for exactly the same inputs. Cached
+  // plans are checked with VerifyMemoryPlan(), and for the right fixed
+  // offsets, before they're used. Plans aren't cached if there's a refinement
+  // time budget, since then the result depends on how fast the machine is.
+  // The cache must outlive the planner, and null turns caching off, which is
+  // the default.
+  void SetPlanCache(MemoryPlanCache* cache);
+
+  // How many bytes SetTimeStepIndex() needs for this many buffers, used at
+  // time steps from zero to time_step_count - 1.
+  static constexpr int GetTimeStepIndexSize(int buffer_count, int time_step_count) {
+    return ((time_step_count + 1) * ((buffer_count + 31) / 32) * static_cast<int>(sizeof(uint32_t))) + (alignof(uint32_t) - 1);
+  }
+
+  // Gives the planner memory for an extra index that keeps a bitset of the
+  // placed buffers in use at each time step. Finding the buffers that overlap
+  // a time range then costs one pass of word-wide bit operations over the
+  // buffers, however long the range is, rather than a search of the interval
+  // tree. That's faster when time steps are dense and there are many active
+  // buffers, but it needs GetTimeStepIndexSize() bytes, which grows with the
+  // number of buffers multiplied by the number of time steps. If the memory
+  // is too small for the buffers being planned, or any are used before time
+  // zero or have a last use before their first, the interval tree is used
+  // instead. Plans are the same either way.
+  // The memory must outlive the planner, and null turns the index off, which
+  // is the default.
+  void SetTimeStepIndex(unsigned char* index_buffer, int index_buffer_size);
+
+  // Whether the last plan used the index from SetTimeStepIndex().
+  bool WasTimeStepIndexUsed() const { return use_time_step_index_; }
+
+  // Whether calculating the current plan moved buffers that already had
+  // offsets from an earlier plan. This is always false for the first plan,
+  // and after a successful incremental update. If it's true, any buffers
+  // that were bound to the old offsets need to be updated.
+  bool HaveExistingOffsetsChanged();
 
  private:
-  // Whether a buffer is active in a given time range.
-  bool DoesEntryOverlapInTime(const ListEntry* entry, const int first_time_used, const int last_time_used) const;
+  // Sorts all the buffers by the time they're first used, and builds an
+  // empty interval tree over that order, ready for placed buffers to be added.
+  void BuildTimeIndex();
+
+  // Records that a buffer has been placed, so that it will be returned by
+  // subsequent calls to FindActiveBuffers().
+  void AddBufferToTimeIndex(int buffer_id);
+
+  // Finds all the placed buffers that are active in a given time range, and
+  // stores where they start and end in the active_offsets_ and active_ends_
+  // arrays, in ascending order of offset. Returns how many were found.
+  int FindActiveBuffers(int first_time_used, int last_time_used);
+
+  // Recursive part of FindActiveBuffers(), covering the buffers in positions
+  // start to end - 1 of the time index.
+  void CollectActiveBuffers(int start, int end, int first_time_used, int last_time_used, int* active_count);
+
+  // Version of FindActiveBuffers() that reads the time step index, adding the
+  // buffers to the active list without sorting it.
+  int CollectActiveBuffersFromTimeSteps(int first_time_used, int last_time_used);
+
+  // The value buffers are sorted by to get the placement order.
+  int GetPlacementOrderKey(const BufferRequirements& requirements) const;
+
+  // Marks every buffer in the time index as not placed.
+  void ClearTimeIndex();
+
+  // Sorts the buffers from first_buffer_id onwards into the placement order,
+  // and finds a place for each one around the buffers already in the time
+  // index.
+  void PlaceBuffers(int first_buffer_id);
+
+  // Finds a place for the buffers in positions start to end - 1 of the
+  // placement order, around the buffers already in the time index.
+  void PlaceBuffersInOrder(int start, int end);
+
+  // Places all the buffers again, keeping the offsets of those before
+  // position start in the placement order, since they can't change.
+  void ReplaceBuffersFrom(int start);
+
+  // Records the offsets of the buffers that were added with
+  // AddBufferAtOffset(), and adds them to the time index.
+  void AddPreplacedBuffers();
+
+  // Makes a completely new plan, either with or without alias groups, using
+  // the time index that's already been built.
+  void PlanAllBuffers(bool use_aliases);
+
+  // The requirements used to place a buffer. If alias groups are in use,
+  // these cover every buffer in the group it starts.
+  void GetPlacementRequirements(int buffer_id, BufferRequirements* requirements) const;
+
+  // Stores the offset of a buffer, and any buffers in the alias group it
+  // starts, and adds them to the time index.
+  void RecordPlacement(int buffer_id, int offset);
+
+  // The cache key for the current buffers and settings.
+  MemoryPlanKey CalculatePlanKey() const;
 
-  // Walks the list to return the next buffer that is active in a given time
-  // range, or a null pointer if there are none.
-  ListEntry* NextValidEntry(const ListEntry* start,  const int first_time_used, const int last_time_used);
+  // Whether the current offsets obey every buffer's alignment and fixed
+  // offset, and keep buffers that are in use at the same time apart, as a
+  // check on plans read from the cache.
+  bool AreOffsetsConsistent() const;
+
+  // Searches for a placement order that gives a smaller arena, as described
+  // for SetRefinementIterations().
+  void RefinePlacementOrder();
+
+  // Returns a pseudo-random number from zero to range - 1.
+  int NextRandom(int range);
+
+  // The high-water mark of the current offsets.
+  int CalculateArenaSize() const;
+
+  // Whether any buffer from the last plan has a different offset now.
+  bool HavePreviousOffsetsMoved() const;
 
   // If there isn't an up to date plan, calculate a new one.
   void CalculateOffsetsIfNeeded();
 
-  // How many buffers we can handle. With dynamic memory allocation this can be
-  // variable, but for simplicity and the ability to run in an embedded
-  // environment, use a hard-coded maximum for now.
-  static constexpr int kMaxBufferCount = 1024;
+  // Marks buffers in the time index that haven't been placed yet. This is
+  // earlier than any real time, so they never overlap a query.
+  static constexpr int kNotPlacedTime = -2147483647 - 1;
 
-  // Records the client-provided information about each buffer.
-  struct BufferRequirements {
-    int size;
-    int first_time_used;
-    int last_time_used;
-  };
-  BufferRequirements requirements_[kMaxBufferCount];
+  // The starting temperature for refinement, as a fraction of the arena size.
+  // An increase of this much is initially kept about a third of the time.
+  static constexpr float kInitialTemperatureFraction = 0.01f;
+
+  // The random number generator's starting state, and the range of values
+  // used to decide whether to keep a change.
+  static constexpr uint32_t kInitialRandomSeed = 1;
+  static constexpr int kRandomRange = 1 << 16;
+
+  // How often the refinement time budget is checked, in iterations.
+  static constexpr int kTimeCheckInterval = 64;
+
+  // Identifies this planner's plans in a cache shared with other planners.
+  // This needs to change if the algorithm does, so old plans aren't reused.
+  static constexpr int kPlanCacheKind = 0x47524431;  // "GRD1"
+
+  // The largest possible sort key, used when an area is too big for an int.
+  static constexpr int kMaxPlacementOrderKey = 2147483647;
+
+  // The most time steps the time step index can cover, with one more bitset
+  // after them for the placed buffers.
+  static constexpr int kMaxTimeStepCount = 2147483647;
+
+  // Parts of the time index this small are searched with a single overlap
+  // mask, since that's cheaper than recursing through them.
+  static constexpr int kOverlapMaskScanSize = 16;
+
+  // The client-provided information about each buffer.
+  BufferRequirements* requirements_;
+
+  // The working arrays are all ints, so the scratch buffer is aligned to that.
+  // The ones between buffer_ids_in_placement_order_ and active_ends_ are laid
+  // out one after another, and are only used while a plan is calculated, so
+  // they're also used as scratch for the lower bound and for checking plans
+  // from the cache.
+  static constexpr int kScratchAlignment = alignof(int);
+
+  // How many bytes of scratch each buffer needs. This is its requirements,
+  // plus an entry in each of the seventeen int arrays below that have their
+  // own memory. See GetScratchBufferSize() for what each part is for.
+  static constexpr int kPerBufferScratchSize = sizeof(BufferRequirements) + (17 * sizeof(int));
+  static constexpr int kIntsPerRequirements = sizeof(BufferRequirements) / sizeof(int);
+  static_assert(GetMemoryLowerBoundScratchCount(1) + kIntsPerRequirements <= 11, "The lower bound needs more scratch than the working arrays hold");
+  static_assert(GetVerifyOffsetsScratchCount(1) + kIntsPerRequirements <= 11, "Checking cached plans needs more scratch than the working arrays hold");
+
+  // How many buffers the scratch memory has room for.
+  int max_buffer_count_;
 
   // The number of buffers added so far.
   int buffer_count_;
 
-  // Working arrays used during the layout algorithm.
-  int buffer_sizes_sorted_by_size_[kMaxBufferCount];
-  int buffer_ids_sorted_by_size_[kMaxBufferCount];
-  ListEntry buffers_sorted_by_offset_[kMaxBufferCount];
-  int next_free_entry_;
+  // Working arrays used during the layout algorithm. All of these point into
+  // the client's scratch buffer, and hold max_buffer_count_ entries.
+  int* buffer_ids_in_placement_order_;
+  int* sort_scratch_values_;
+  int* sort_scratch_ids_;
+
+  // The time index is an interval tree laid out implicitly over the buffers
+  // sorted by their first use. The node for the positions start to end - 1 is
+  // stored at the middle position, and holds the latest last_time_used of any
+  // placed buffer in that range, so whole subtrees that finish too early can
+  // be skipped. Buffers that haven't been placed yet use kNotPlacedTime.
+  // Everything a query needs about a buffer is kept in separate arrays in the
+  // same order, so the search reads memory sequentially rather than jumping
+  // around the requirements and offsets through buffer ids.
+  int* time_index_positions_;
+  int* first_times_sorted_by_first_time_;
+  int* placed_last_times_;
+  int* placed_offsets_;
+  int* placed_ends_;
+  int* subtree_max_last_times_;
+
+  // The placed buffers found by the last FindActiveBuffers() call, as a
+  // packed list sorted by offset.
+  int* active_offsets_;
+  int* active_ends_;
+
+  // These are only needed while sorting, before any buffers are placed, so
+  // they share memory with the active list.
+  int* placement_order_keys_;
+  int* buffer_ids_sorted_by_first_time_;
 
   // Stores the outcome of the plan, the location of each buffer in the arena.
-  int buffer_offsets_[kMaxBufferCount];
+  int* buffer_offsets_;
+
+  // The offsets from the last plan, kept while a full plan is calculated to
+  // tell whether any of them moved.
+  int* previous_offsets_;
+
+  // The placement order of the smallest plan refinement has found so far.
+  int* best_placement_order_;
+
+  // The buffer each one reuses the memory of, and the buffer that reuses its
+  // memory, from AddAliasPair(). Both are -1 if there isn't one.
+  int* alias_inputs_;
+  int* alias_outputs_;
+
+  // The offset each buffer was given by AddBufferAtOffset(), or -1.
+  int* preplaced_offsets_;
 
   // Whether buffers have been added since the last plan was calculated.
   bool need_to_calculate_offsets_;
+
+  // The order buffers are placed in, from SetBufferOrdering().
+  BufferOrdering buffer_ordering_;
+
+  // Which gaps buffers are placed in, from SetGapSelectionPolicy().
+  GapSelectionPolicy gap_selection_policy_;
+
+  // Settings for incremental planning, from SetIncrementalPlanning().
+  bool incremental_planning_;
+  int max_incremental_growth_percent_;
+
+  // How many buffers were included in the last plan, and its arena size.
+  int planned_buffer_count_;
+  int planned_arena_size_;
+
+  // Whether the last plan moved buffers placed by an earlier one.
+  bool existing_offsets_changed_;
+
+  // Whether any setting that affects the plan has changed since the last one
+  // was calculated, which rules out an incremental update.
+  bool have_settings_changed_;
+
+  // Settings for refinement, and the state of its random number generator.
+  int refinement_iteration_count_;
+  int64_t (*current_time_)();
+  int64_t max_refinement_duration_;
+  uint32_t random_seed_;
+
+  // How many entries of buffer_ids_in_placement_order_ the last call to
+  // PlaceBuffers() filled in.
+  int placement_order_count_;
+
+  // How many alias pairs there are, whether any have been added since the
+  // last plan, and whether alias groups are placed as single allocations in
+  // the current plan.
+  int alias_pair_count_;
+  bool have_alias_pairs_changed_;
+  bool use_aliases_;
+
+  // Where full plans are cached, from SetPlanCache().
+  MemoryPlanCache* plan_cache_;
+
+  // The optional index from SetTimeStepIndex(). If it's in use, it holds a
+  // bitset over time index positions for each time step, marking the placed
+  // buffers in use at that step, followed by one marking every placed
+  // buffer. Each bitset is time_step_index_word_count_ words long.
+  uint32_t* time_step_index_;
+  int time_step_index_size_;
+  bool use_time_step_index_;
+  int time_step_count_;
+  int time_step_index_word_count_;
 };
 
+namespace internal {
+
+// The first-fit gap search the greedy planner uses by default, for other
+// planners that place buffers among ones that are already active. The active
+// buffers must be in ascending order of offset. Unlike the constexpr version
+// in greedy_placement.h, this doesn't need C++14.
+int ChooseFirstFitOffset(const int* active_offsets, const int* active_ends, int active_count, int wanted_size, int wanted_alignment);
+
+}  // namespace internal
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_MEMORY_PLANNER_H_
@@ -0,0 +1,90 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_PLACEMENT_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_PLACEMENT_H_
+
+#include <cstdint>
+
+#include "greedy_memory_planner.h"
+#include "memory_planner.h"
+
+// The ordering and gap selection steps of the greedy algorithm, shared by the
+// planners that are built entirely from templates. They match the versions in
+// greedy_memory_planner.cc, so every greedy planner gives the same offsets for
+// the same buffers. These need C++14's relaxed constexpr rules.
+
+namespace tflite {
+namespace internal {
+
+// Matches GreedyMemoryPlanner::GetPlacementOrderKey().
+constexpr int GetGreedyPlacementOrderKey(const BufferRequirements& requirements, GreedyMemoryPlanner::BufferOrdering ordering) {
+  const int lifetime = (requirements.last_time_used - requirements.first_time_used) + 1;
+  switch (ordering) {
+    case GreedyMemoryPlanner::kLifetimeDescending:
+      return lifetime;
+    case GreedyMemoryPlanner::kAreaDescending: {
+      const int64_t area = static_cast<int64_t>(requirements.size) * lifetime;
+      return (area > 2147483647) ? 2147483647 : static_cast<int>(area);
+    }
+    case GreedyMemoryPlanner::kFirstUseAscending:
+      return requirements.first_time_used;
+    case GreedyMemoryPlanner::kSizeDescending:
+    default:
+      return requirements.size;
+  }
+}
+
+// Whether a buffer with the first key should be placed before one with the
+// second, when the first was added later. Equal keys keep the order buffers
+// were added in.
+constexpr bool IsEarlierInGreedyPlacementOrder(int key, int other_key, GreedyMemoryPlanner::BufferOrdering ordering) {
+  return (ordering == GreedyMemoryPlanner::kFirstUseAscending) ? (key < other_key) : (key > other_key);
+}
+
+// Matches ChooseOffset() in greedy_memory_planner.cc. The active buffers must
+// be in ascending order of offset.
+template <typename OffsetType>
+constexpr int ChooseGreedyOffset(const OffsetType* active_offsets, const OffsetType* active_ends, int active_count, int wanted_size, int wanted_alignment, GreedyMemoryPlanner::GapSelectionPolicy policy) {
+  int candidate_offset = 0;
+  int chosen_offset = -1;
+  int chosen_gap = 0;
+  for (int j = 0; j < active_count; ++j) {
+    const int aligned_offset = AlignOffset(candidate_offset, wanted_alignment);
+    const int gap = static_cast<int>(active_offsets[j]) - aligned_offset;
+    if (gap >= wanted_size) {
+      if (policy == GreedyMemoryPlanner::kFirstFit) {
+        return aligned_offset;
+      }
+      const bool is_better = (policy == GreedyMemoryPlanner::kBestFit) ? (gap < chosen_gap) : (gap > chosen_gap);
+      if ((chosen_offset == -1) || is_better) {
+        chosen_offset = aligned_offset;
+        chosen_gap = gap;
+      }
+    }
+    if (static_cast<int>(active_ends[j]) > candidate_offset) {
+      candidate_offset = active_ends[j];
+    }
+  }
+  if (chosen_offset != -1) {
+    return chosen_offset;
+  }
+  return AlignOffset(candidate_offset, wanted_alignment);
+}
+
+}  // namespace internal
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_GREEDY_PLACEMENT_H_
@@ -15,18 +15,41 @@ limitations under the License.
 
 #include "linear_memory_planner.h"
 
+#include <cstdint>
+
 namespace tflite {
 
-LinearMemoryPlanner::LinearMemoryPlanner() : current_buffer_count_(0), next_free_offset_(0) {}
+LinearMemoryPlanner::LinearMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size) : current_buffer_count_(0), next_free_offset_(0) {
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  buffer_offsets_ = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / static_cast<int>(sizeof(int));
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+}
+
 LinearMemoryPlanner::~LinearMemoryPlanner() {}
 
 bool LinearMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
-  if (current_buffer_count_ >= kMaxBufferCount) {
-    error_reporter->Report("Too many buffers (max is %d)", kMaxBufferCount);
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool LinearMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (current_buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
     return false;
   }
-  buffer_offsets_[current_buffer_count_] = next_free_offset_;
-  next_free_offset_ += size;
+  const int offset = AlignOffset(next_free_offset_, alignment);
+  buffer_offsets_[current_buffer_count_] = offset;
+  next_free_offset_ = offset + size;
   ++current_buffer_count_;
   return true;
 }
@@ -21,21 +21,32 @@ limitations under the License.
 namespace tflite {
 
 // The simplest possible memory planner that just lays out all buffers at
-// increasing offsets without trying to reuse memory. 
+// increasing offsets without trying to reuse memory. Like the other planners
+// it stores the offsets in a scratch buffer owned by the client, so the number
+// of buffers it can handle depends on the size of that buffer.
 class LinearMemoryPlanner : public MemoryPlanner {
  public:
-  LinearMemoryPlanner();
+  LinearMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
   virtual ~LinearMemoryPlanner() override;
 
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including room for alignment.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * sizeof(int)) + (kScratchAlignment - 1);
+  }
+
   virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
 
   virtual int GetMaximumMemorySize() override;
   virtual int GetBufferCount() override;
   virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) override;
 
  private:
-  static constexpr int kMaxBufferCount = 1024;
-  int buffer_offsets_[kMaxBufferCount];
+  static constexpr int kScratchAlignment = alignof(int);
+
+  int* buffer_offsets_;
+  int max_buffer_count_;
   int current_buffer_count_;
   int next_free_offset_;
 };
@@ -19,13 +19,40 @@ limitations under the License.
 
 #include "micro_test.h"
 
+namespace {
+
+// Simple but slow check that no buffers that are active at the same time have
+// been placed in overlapping memory.
+bool DoAnyBuffersOverlap(tflite::ErrorReporter* error_reporter, tflite::MemoryPlanner* planner, const int* sizes, const int* first_times, const int* last_times, int count) {
+  for (int i = 0; i < count; ++i) {
+    int i_offset;
+    planner->GetOffsetForBuffer(error_reporter, i, &i_offset);
+    for (int j = i + 1; j < count; ++j) {
+      if ((first_times[i] > last_times[j]) || (first_times[j] > last_times[i])) {
+        continue;
+      }
+      int j_offset;
+      planner->GetOffsetForBuffer(error_reporter, j, &j_offset);
+      if ((i_offset < (j_offset + sizes[j])) && (j_offset < (i_offset + sizes[i]))) {
+        error_reporter->Report("Buffers %d and %d overlap", i, j);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 TF_LITE_MICRO_TESTS_BEGIN
 
 TF_LITE_MICRO_TEST(TestBasics) {
   tflite::MicroErrorReporter micro_error_reporter;
   tflite::ErrorReporter* error_reporter = &micro_error_reporter;
 
-  tflite::LinearMemoryPlanner planner;
+  constexpr int scratch_buffer_size = tflite::LinearMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::LinearMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2));
   TF_LITE_MICRO_EXPECT_EQ(30, planner.GetMaximumMemorySize());
@@ -42,13 +69,34 @@ TF_LITE_MICRO_TEST(TestErrorHandling) {
   tflite::MicroErrorReporter micro_error_reporter;
   tflite::ErrorReporter* error_reporter = &micro_error_reporter;
 
-  tflite::LinearMemoryPlanner planner;
+  constexpr int scratch_buffer_size = tflite::LinearMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::LinearMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
 
   int offset = -1;
   TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
 }
 
+TF_LITE_MICRO_TEST(TestAlignment) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::LinearMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::LinearMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2, 16));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 30, 2, 3, 12));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 30, 2, 3, 0));
+  TF_LITE_MICRO_EXPECT_EQ(36, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(2, planner.GetBufferCount());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(16, offset);
+}
+
 TF_LITE_MICRO_TEST(TestReverseSortInPlace) {
   tflite::MicroErrorReporter micro_error_reporter;
   tflite::ErrorReporter* error_reporter = &micro_error_reporter;
@@ -87,11 +135,52 @@ TF_LITE_MICRO_TEST(TestReverseSortInPlace) {
   }
 }
 
+TF_LITE_MICRO_TEST(TestReverseSortWithScratch) {
+  constexpr int a_size = 10;
+  int a_values[a_size] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  int a_ids[a_size] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  int a_scratch_values[a_size];
+  int a_scratch_ids[a_size];
+  const int a_expected_values[a_size] = {10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+  const int a_expected_ids[a_size] = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  tflite::ReverseSortWithScratch(a_values, a_ids, a_size, a_scratch_values, a_scratch_ids);
+  for (int i = 0; i < a_size; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(a_expected_values[i], a_values[i]);
+    TF_LITE_MICRO_EXPECT_EQ(a_expected_ids[i], a_ids[i]);
+  }
+
+  // Compare against the simple sort on an array long enough to need several
+  // merge passes, with plenty of ties to check stability.
+  constexpr int b_size = 1000;
+  int b_values[b_size];
+  int b_ids[b_size];
+  int b_expected_values[b_size];
+  int b_expected_ids[b_size];
+  int b_scratch_values[b_size];
+  int b_scratch_ids[b_size];
+  unsigned int seed = 1;
+  for (int i = 0; i < b_size; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    b_values[i] = (seed >> 16) % 50;
+    b_ids[i] = i;
+    b_expected_values[i] = b_values[i];
+    b_expected_ids[i] = i;
+  }
+  tflite::ReverseSortInPlace(b_expected_values, b_expected_ids, b_size);
+  tflite::ReverseSortWithScratch(b_values, b_ids, b_size, b_scratch_values, b_scratch_ids);
+  for (int i = 0; i < b_size; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(b_expected_values[i], b_values[i]);
+    TF_LITE_MICRO_EXPECT_EQ(b_expected_ids[i], b_ids[i]);
+  }
+}
+
 TF_LITE_MICRO_TEST(TestGreedyBasics) {
   tflite::MicroErrorReporter micro_error_reporter;
   tflite::ErrorReporter* error_reporter = &micro_error_reporter;
 
-  tflite::GreedyMemoryPlanner planner;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 2, 3));
   TF_LITE_MICRO_EXPECT_EQ(20, planner.GetMaximumMemorySize());
@@ -108,7 +197,9 @@ TF_LITE_MICRO_TEST(TestGreedyMedium) {
   tflite::MicroErrorReporter micro_error_reporter;
   tflite::ErrorReporter* error_reporter = &micro_error_reporter;
 
-  tflite::GreedyMemoryPlanner planner;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2));
   TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 3));
@@ -136,4 +227,479 @@ TF_LITE_MICRO_TEST(TestGreedyMedium) {
   TF_LITE_MICRO_EXPECT_EQ(0, offset);
 }
 
+TF_LITE_MICRO_TEST(TestGreedyOverlappingActiveBuffers) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The first two buffers sit at the same offset but at different times, and
+  // the third has to avoid both of them, not just the one placed last.
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 3, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 0, 4));
+  TF_LITE_MICRO_EXPECT_EQ(140, planner.GetMaximumMemorySize());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 2, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(100, offset);
+}
+
+TF_LITE_MICRO_TEST(TestGreedyGapAtStart) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The last buffer only overlaps in time with the second, which is placed
+  // above the first, so it fits in below it at offset zero.
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(150, planner.GetMaximumMemorySize());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(100, offset);
+
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 2, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+}
+
+TF_LITE_MICRO_TEST(TestGreedyScratchBufferSize) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Offset the start of the scratch memory to make sure misaligned pointers
+  // still leave room for the requested number of buffers.
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(3);
+  unsigned char scratch_buffer[scratch_buffer_size + 1];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer + 1, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(3, planner.GetMaxBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 40, 3, 4));
+  TF_LITE_MICRO_EXPECT_EQ(50, planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TEST(TestGreedyIncremental) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  planner.SetIncrementalPlanning(true, 10);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(150, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.HaveExistingOffsetsChanged());
+
+  // A small buffer that fits in the gap below the second one, at a time when
+  // the first isn't active, leaves the existing offsets alone.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(150, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.HaveExistingOffsetsChanged());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(100, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 2, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+
+  // A large buffer would grow the arena by far more than 10% if it was just
+  // added on top, so this forces a complete replan.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 200, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(350, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.HaveExistingOffsetsChanged());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 3, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+
+  // Changing a setting needs a full plan, even with no new buffers.
+  planner.SetBufferOrdering(tflite::GreedyMemoryPlanner::kFirstUseAscending);
+  TF_LITE_MICRO_EXPECT_EQ(350, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.HaveExistingOffsetsChanged());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 3, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(150, offset);
+
+  // Best fit finds the same gaps here, so the full plan doesn't move
+  // anything.
+  planner.SetGapSelectionPolicy(tflite::GreedyMemoryPlanner::kBestFit);
+  TF_LITE_MICRO_EXPECT_EQ(350, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.HaveExistingOffsetsChanged());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 3, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(150, offset);
+}
+
+TF_LITE_MICRO_TEST(TestGreedyGapSelectionPolicies) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 8;
+  const int sizes[buffer_count] = {90, 60, 80, 100, 50, 90, 80, 60};
+  const int first_times[buffer_count] = {1, 0, 1, 1, 2, 0, 1, 3};
+  const int last_times[buffer_count] = {3, 2, 3, 1, 4, 2, 3, 5};
+  const tflite::GreedyMemoryPlanner::GapSelectionPolicy policies[] = {
+      tflite::GreedyMemoryPlanner::kFirstFit,
+      tflite::GreedyMemoryPlanner::kBestFit,
+      tflite::GreedyMemoryPlanner::kWorstFit,
+  };
+  const int expected_sizes[] = {550, 500, 550};
+  for (int p = 0; p < 3; ++p) {
+    constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+    unsigned char scratch_buffer[scratch_buffer_size];
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    planner.SetGapSelectionPolicy(policies[p]);
+    for (int i = 0; i < buffer_count; ++i) {
+      TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+    }
+    TF_LITE_MICRO_EXPECT_EQ(expected_sizes[p], planner.GetMaximumMemorySize());
+    TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+  }
+
+  // The buffers that only live at time zero leave two gaps at time two, of
+  // 100 and 85 bytes. The first small buffer goes into the larger one with
+  // first and worst fit, and into the smaller one with best fit, so the last
+  // buffer sees a different pair of gaps with each policy. Its offset shows
+  // which gap each policy picked.
+  constexpr int gap_buffer_count = 6;
+  const int gap_sizes[gap_buffer_count] = {100, 90, 85, 80, 50, 30};
+  const int gap_first_times[gap_buffer_count] = {0, 0, 0, 0, 2, 2};
+  const int gap_last_times[gap_buffer_count] = {0, 2, 0, 2, 2, 2};
+  const int expected_offsets[] = {50, 240, 190};
+  for (int p = 0; p < 3; ++p) {
+    constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(gap_buffer_count);
+    unsigned char scratch_buffer[scratch_buffer_size];
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    planner.SetGapSelectionPolicy(policies[p]);
+    for (int i = 0; i < gap_buffer_count; ++i) {
+      TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, gap_sizes[i], gap_first_times[i], gap_last_times[i]));
+    }
+    TF_LITE_MICRO_EXPECT_EQ(355, planner.GetMaximumMemorySize());
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 5, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[p], offset);
+    TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, gap_sizes, gap_first_times, gap_last_times, gap_buffer_count));
+  }
+}
+
+TF_LITE_MICRO_TEST(TestGreedyOptimalityGap) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 8;
+  const int sizes[buffer_count] = {90, 60, 80, 100, 50, 90, 80, 60};
+  const int first_times[buffer_count] = {1, 0, 1, 1, 2, 0, 1, 3};
+  const int last_times[buffer_count] = {3, 2, 3, 1, 4, 2, 3, 5};
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetMemoryLowerBound());
+  TF_LITE_MICRO_EXPECT_NEAR(1.0f, planner.GetOptimalityRatio(), 0.0001f);
+  for (int i = 0; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+  }
+
+  // Everything but buffers 4 and 7 is active at time 1.
+  TF_LITE_MICRO_EXPECT_EQ(550, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(500, planner.GetMemoryLowerBound());
+  TF_LITE_MICRO_EXPECT_EQ(50, planner.GetOptimalityGap());
+  TF_LITE_MICRO_EXPECT_NEAR(1.1f, planner.GetOptimalityRatio(), 0.0001f);
+
+  // Working out the bound mustn't disturb the plan.
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+  planner.SetGapSelectionPolicy(tflite::GreedyMemoryPlanner::kBestFit);
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetOptimalityGap());
+}
+
+TF_LITE_MICRO_TEST(TestGreedyRefinement) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Placing by size needs 280 bytes here, but there's a 260 byte plan.
+  constexpr int buffer_count = 6;
+  const int sizes[buffer_count] = {60, 30, 90, 30, 100, 80};
+  const int first_times[buffer_count] = {1, 0, 1, 2, 3, 0};
+  const int last_times[buffer_count] = {1, 2, 3, 2, 3, 1};
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(280, planner.GetMaximumMemorySize());
+  planner.SetRefinementIterations(100);
+  TF_LITE_MICRO_EXPECT_EQ(260, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+
+  // A time budget that's already used up leaves the plan as it was.
+  planner.SetRefinementTimeBudget([]() -> int64_t { return 0; }, 0);
+  TF_LITE_MICRO_EXPECT_EQ(280, planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TEST(TestGreedyAliasPairs) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // A convolution followed by two element-wise ops, which can all write over
+  // their inputs, alongside a buffer that's alive the whole time.
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(8);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 0, 3));
+  TF_LITE_MICRO_EXPECT_EQ(220, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddAliasPair(error_reporter, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddAliasPair(error_reporter, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(120, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(120, planner.GetMemoryLowerBound());
+  for (int i = 0; i < 3; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(0, offset);
+  }
+
+  // Pairs have to hand over on the same time step, and can't branch.
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddAliasPair(error_reporter, 0, 2));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddAliasPair(error_reporter, 0, 3));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddAliasPair(error_reporter, 2, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddAliasPair(error_reporter, 0, 4));
+
+  // Buffers that are only used for one step can hand over in either
+  // direction, but pairs that would close a chain into a cycle are rejected,
+  // since the chain would have no first buffer to place it from.
+  constexpr int cycle_buffer_count = 4;
+  const int cycle_sizes[cycle_buffer_count] = {100, 100, 100, 100};
+  const int cycle_first_times[cycle_buffer_count] = {0, 0, 0, 0};
+  const int cycle_last_times[cycle_buffer_count] = {0, 0, 0, 1};
+  tflite::GreedyMemoryPlanner cycle_planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < cycle_buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, cycle_planner.AddBuffer(error_reporter, cycle_sizes[i], cycle_first_times[i], cycle_last_times[i]));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, cycle_planner.AddAliasPair(error_reporter, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, cycle_planner.AddAliasPair(error_reporter, 1, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, cycle_planner.AddAliasPair(error_reporter, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(false, cycle_planner.AddAliasPair(error_reporter, 2, 0));
+  TF_LITE_MICRO_EXPECT_EQ(200, cycle_planner.GetMaximumMemorySize());
+  int last_offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, cycle_planner.GetOffsetForBuffer(error_reporter, 3, &last_offset));
+  for (int i = 0; i < 3; ++i) {
+    int chain_offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, cycle_planner.GetOffsetForBuffer(error_reporter, i, &chain_offset));
+    TF_LITE_MICRO_EXPECT_EQ(100, (chain_offset > last_offset) ? (chain_offset - last_offset) : (last_offset - chain_offset));
+  }
+
+  // Merging a small buffer into a large one that outlives it would stop
+  // another buffer reusing the space, so the pair isn't used.
+  tflite::GreedyMemoryPlanner unmerged_planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, unmerged_planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, unmerged_planner.AddBuffer(error_reporter, 100, 1, 5));
+  TF_LITE_MICRO_EXPECT_EQ(true, unmerged_planner.AddBuffer(error_reporter, 100, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, unmerged_planner.AddAliasPair(error_reporter, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(110, unmerged_planner.GetMaximumMemorySize());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, unmerged_planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(100, offset);
+}
+
+TF_LITE_MICRO_TEST(TestGreedyFixedOffsets) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 4;
+  const int sizes[buffer_count + 2] = {20, 40, 60, 30, 10, 20};
+  const int first_times[buffer_count + 2] = {0, 0, 1, 2, 3, 1};
+  const int last_times[buffer_count + 2] = {2, 1, 2, 3, 3, 2};
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count + 2);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBufferAtOffset(error_reporter, 20, 0, 2, -1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBufferAtOffset(error_reporter, sizes[0], first_times[0], last_times[0], 50));
+  for (int i = 1; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddAliasPair(error_reporter, 0, 3));
+
+  // The gap below the fixed buffer is too small for the largest buffer, so
+  // it goes above, and the next largest fits underneath.
+  const int expected_offsets[buffer_count] = {50, 0, 70, 0};
+  for (int i = 0; i < buffer_count; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(130, planner.GetMaximumMemorySize());
+
+  // Fixed buffers stay put through refinement and incremental updates.
+  planner.SetRefinementIterations(100);
+  planner.SetIncrementalPlanning(true, 100);
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(50, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBufferAtOffset(error_reporter, sizes[4], first_times[4], last_times[4], 200));
+  TF_LITE_MICRO_EXPECT_EQ(210, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.HaveExistingOffsetsChanged());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 4, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(200, offset);
+
+  // This one lands on the buffer at 70, which is in use at the same time, so
+  // that has to move out of its way.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBufferAtOffset(error_reporter, sizes[5], first_times[5], last_times[5], 80));
+  TF_LITE_MICRO_EXPECT_EQ(210, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.HaveExistingOffsetsChanged());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 5, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(80, offset);
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count + 2));
+}
+
+TF_LITE_MICRO_TEST(TestGreedyAlignment) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The larger buffer goes first at zero, and the smaller one has to skip
+  // past the end of it to the next aligned offset.
+  constexpr int small_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(2);
+  unsigned char small_scratch_buffer[small_scratch_buffer_size];
+  tflite::GreedyMemoryPlanner small_planner(small_scratch_buffer, small_scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, 5, 1, 2, 16));
+  TF_LITE_MICRO_EXPECT_EQ(false, small_planner.AddBuffer(error_reporter, 5, 1, 2, 24));
+  TF_LITE_MICRO_EXPECT_EQ(21, small_planner.GetMaximumMemorySize());
+
+  constexpr int buffer_count = 200;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  const int alignments[] = {1, 4, 16, 64};
+  int sizes[buffer_count];
+  int first_times[buffer_count];
+  int last_times[buffer_count];
+  unsigned int seed = 1;
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    sizes[i] = 1 + ((seed >> 8) % 500);
+    seed = (seed * 1103515245) + 12345;
+    first_times[i] = (seed >> 8) % 100;
+    seed = (seed * 1103515245) + 12345;
+    last_times[i] = first_times[i] + ((seed >> 8) % 10);
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i], alignments[i % 4]));
+  }
+  for (int i = 0; i < buffer_count; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(0, offset % alignments[i % 4]);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+}
+
+TF_LITE_MICRO_TEST(TestGreedyTimeStepIndex) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The bitset index should give exactly the same plans as the interval
+  // tree, including with alias groups and refinement, which re-place buffers.
+  constexpr int buffer_count = 300;
+  constexpr int time_step_count = 160;
+  // There's room for one more buffer, for the fallback check at the end.
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count + 1);
+  static unsigned char tree_scratch_buffer[scratch_buffer_size];
+  static unsigned char indexed_scratch_buffer[scratch_buffer_size];
+  constexpr int index_size = tflite::GreedyMemoryPlanner::GetTimeStepIndexSize(buffer_count, time_step_count);
+  static unsigned char index_buffer[index_size];
+  tflite::GreedyMemoryPlanner tree_planner(tree_scratch_buffer, scratch_buffer_size);
+  tflite::GreedyMemoryPlanner indexed_planner(indexed_scratch_buffer, scratch_buffer_size);
+  indexed_planner.SetTimeStepIndex(index_buffer, index_size);
+  tree_planner.SetRefinementIterations(200);
+  indexed_planner.SetRefinementIterations(200);
+  int sizes[buffer_count];
+  int first_times[buffer_count];
+  int last_times[buffer_count];
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    sizes[i] = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    first_times[i] = (seed >> 16) % 150;
+    seed = (seed * 1103515245) + 12345;
+    last_times[i] = first_times[i] + ((seed >> 16) % 10);
+    TF_LITE_MICRO_EXPECT_EQ(true, tree_planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i], 1 << (i % 3)));
+    TF_LITE_MICRO_EXPECT_EQ(true, indexed_planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i], 1 << (i % 3)));
+  }
+  for (int i = 1; i < buffer_count; ++i) {
+    if ((last_times[i - 1] == first_times[i]) && ((i % 4) == 0)) {
+      TF_LITE_MICRO_EXPECT_EQ(true, tree_planner.AddAliasPair(error_reporter, i - 1, i));
+      TF_LITE_MICRO_EXPECT_EQ(true, indexed_planner.AddAliasPair(error_reporter, i - 1, i));
+    }
+  }
+  TF_LITE_MICRO_EXPECT_EQ(tree_planner.GetMaximumMemorySize(), indexed_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, indexed_planner.WasTimeStepIndexUsed());
+  TF_LITE_MICRO_EXPECT_EQ(false, tree_planner.WasTimeStepIndexUsed());
+  for (int i = 0; i < buffer_count; ++i) {
+    int tree_offset = -1;
+    int indexed_offset = -2;
+    tree_planner.GetOffsetForBuffer(error_reporter, i, &tree_offset);
+    indexed_planner.GetOffsetForBuffer(error_reporter, i, &indexed_offset);
+    TF_LITE_MICRO_EXPECT_EQ(tree_offset, indexed_offset);
+  }
+
+  // If the index is too small for the buffers, the tree is used instead.
+  TF_LITE_MICRO_EXPECT_EQ(true, indexed_planner.AddBuffer(error_reporter, 100, 0, time_step_count * 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, indexed_planner.GetMaximumMemorySize() > 0);
+  TF_LITE_MICRO_EXPECT_EQ(false, indexed_planner.WasTimeStepIndexUsed());
+
+  // A buffer whose first use is after its last can start past every other
+  // time, so it has to turn the index off rather than be looked up in it.
+  constexpr int small_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(4);
+  unsigned char small_scratch_buffer[small_scratch_buffer_size];
+  constexpr int small_index_size = tflite::GreedyMemoryPlanner::GetTimeStepIndexSize(3, 4);
+  unsigned char small_index_buffer[small_index_size];
+  tflite::GreedyMemoryPlanner small_planner(small_scratch_buffer, small_scratch_buffer_size);
+  small_planner.SetTimeStepIndex(small_index_buffer, small_index_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, 50, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.GetMaximumMemorySize() > 0);
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.WasTimeStepIndexUsed());
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, 50, 9, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, small_planner.GetMaximumMemorySize() > 0);
+  TF_LITE_MICRO_EXPECT_EQ(false, small_planner.WasTimeStepIndexUsed());
+
+  // The largest possible time can't have a step count, so it's left to the
+  // tree as well.
+  tflite::GreedyMemoryPlanner large_time_planner(small_scratch_buffer, small_scratch_buffer_size);
+  large_time_planner.SetTimeStepIndex(small_index_buffer, small_index_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, large_time_planner.AddBuffer(error_reporter, 100, 0, 2147483647));
+  TF_LITE_MICRO_EXPECT_EQ(100, large_time_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, large_time_planner.WasTimeStepIndexUsed());
+}
+
+TF_LITE_MICRO_TEST(TestGreedyManyBuffers) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 1000;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  int sizes[buffer_count];
+  int first_times[buffer_count];
+  int last_times[buffer_count];
+  unsigned int seed = 1;
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    sizes[i] = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    first_times[i] = (seed >> 16) % 500;
+    seed = (seed * 1103515245) + 12345;
+    last_times[i] = first_times[i] + ((seed >> 16) % 20);
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, DoAnyBuffersOverlap(error_reporter, &planner, sizes, first_times, last_times, buffer_count));
+}
+
 TF_LITE_MICRO_TESTS_END
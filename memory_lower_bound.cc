@@ -0,0 +1,64 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_lower_bound.h"
+
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+
+int CalculateMemoryLowerBound(const BufferRequirements* requirements, int buffer_count, int* scratch) {
+  int* first_times = scratch;
+  int* first_sizes = first_times + buffer_count;
+  int* last_times = first_sizes + buffer_count;
+  int* last_sizes = last_times + buffer_count;
+  int* sort_scratch_values = last_sizes + buffer_count;
+  int* sort_scratch_ids = sort_scratch_values + buffer_count;
+  for (int i = 0; i < buffer_count; ++i) {
+    first_times[i] = requirements[i].first_time_used;
+    first_sizes[i] = requirements[i].size;
+    last_times[i] = requirements[i].last_time_used;
+    last_sizes[i] = requirements[i].size;
+  }
+  SortWithScratch(first_times, first_sizes, buffer_count, sort_scratch_values, sort_scratch_ids);
+  SortWithScratch(last_times, last_sizes, buffer_count, sort_scratch_values, sort_scratch_ids);
+
+  // The live total only peaks when a buffer starts, so step through the
+  // starts in time order, first retiring any buffers that finished before.
+  int live_size = 0;
+  int max_live_size = 0;
+  int next_last = 0;
+  for (int i = 0; i < buffer_count; ++i) {
+    const int time = first_times[i];
+    while ((next_last < buffer_count) && (last_times[next_last] < time)) {
+      live_size -= last_sizes[next_last];
+      ++next_last;
+    }
+    live_size += first_sizes[i];
+    if (live_size > max_live_size) {
+      max_live_size = live_size;
+    }
+  }
+  return max_live_size;
+}
+
+float CalculateOptimalityRatio(int arena_size, int lower_bound) {
+  if (lower_bound == 0) {
+    return 1.0f;
+  }
+  return static_cast<float>(arena_size) / static_cast<float>(lower_bound);
+}
+
+}  // namespace tflite
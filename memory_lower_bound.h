@@ -0,0 +1,39 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_LOWER_BOUND_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_LOWER_BOUND_H_
+
+#include "memory_planner.h"
+
+namespace tflite {
+
+// How many ints of scratch memory CalculateMemoryLowerBound() needs.
+constexpr int GetMemoryLowerBoundScratchCount(int buffer_count) { return buffer_count * 6; }
+
+// Returns the largest total size of buffers that are all active at the same
+// time step. No plan can use a smaller arena than this, so it's a lower bound
+// on GetMaximumMemorySize() for any planner. It's found with a sweep over the
+// buffers sorted by first and last use, so it takes O(n log n) time. The
+// scratch array must hold GetMemoryLowerBoundScratchCount(buffer_count) ints.
+int CalculateMemoryLowerBound(const BufferRequirements* requirements, int buffer_count, int* scratch);
+
+// How many times larger than the lower bound an arena is. A ratio of 1.0
+// means the plan is optimal, and it's also 1.0 if there's nothing to plan.
+float CalculateOptimalityRatio(int arena_size, int lower_bound);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_LOWER_BOUND_H_
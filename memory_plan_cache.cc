@@ -0,0 +1,147 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_plan_cache.h"
+
+namespace tflite {
+namespace {
+
+// The standard 64-bit FNV-1a parameters.
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+
+// The splitmix64 finalizer, used for the independent check hash.
+uint64_t MixBits(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+bool AreKeysEqual(const MemoryPlanKey& a, const MemoryPlanKey& b) { return (a.hash == b.hash) && (a.check == b.check); }
+
+}  // namespace
+
+MemoryPlanHasher::MemoryPlanHasher() {
+  key_.hash = kFnvOffsetBasis;
+  key_.check = 0;
+}
+
+void MemoryPlanHasher::AddInt(int value) {
+  const uint32_t bits = static_cast<uint32_t>(value);
+  // Hash the bytes in a fixed order, so keys match across platforms.
+  for (int i = 0; i < 4; ++i) {
+    key_.hash ^= (bits >> (i * 8)) & 0xff;
+    key_.hash *= kFnvPrime;
+  }
+  key_.check = MixBits(key_.check + 0x9e3779b97f4a7c15ULL + bits);
+}
+
+uint32_t CalculateMemoryPlanChecksum(const int* offsets, int buffer_count) {
+  MemoryPlanHasher hasher;
+  hasher.AddInt(buffer_count);
+  for (int i = 0; i < buffer_count; ++i) {
+    hasher.AddInt(offsets[i]);
+  }
+  const MemoryPlanKey key = hasher.GetKey();
+  return static_cast<uint32_t>(key.hash ^ (key.hash >> 32));
+}
+
+MemoryPlanCache::MemoryPlanCache(unsigned char* storage, int storage_size, int max_buffer_count, MemoryPlanStore* store)
+    : slot_size_(GetSlotSize(max_buffer_count)), max_buffer_count_(max_buffer_count), store_(store), use_count_(0), hit_count_(0), miss_count_(0) {
+  const int misalignment = reinterpret_cast<uintptr_t>(storage) % kStorageAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kStorageAlignment - misalignment;
+  }
+  storage_ = storage + alignment_padding;
+  slot_count_ = (storage_size - alignment_padding) / slot_size_;
+  if (slot_count_ < 0) {
+    slot_count_ = 0;
+  }
+  for (int i = 0; i < slot_count_; ++i) {
+    GetSlot(i)->last_used = 0;
+  }
+}
+
+MemoryPlanCache::SlotHeader* MemoryPlanCache::GetSlot(int slot_index) const {
+  return reinterpret_cast<SlotHeader*>(storage_ + (slot_index * slot_size_));
+}
+
+int* MemoryPlanCache::GetSlotOffsets(int slot_index) const {
+  return reinterpret_cast<int*>(GetSlot(slot_index) + 1);
+}
+
+bool MemoryPlanCache::FindPlan(const MemoryPlanKey& key, int buffer_count, int* offsets) {
+  for (int i = 0; i < slot_count_; ++i) {
+    SlotHeader* slot = GetSlot(i);
+    if ((slot->last_used == 0) || !AreKeysEqual(slot->key, key) || (slot->buffer_count != buffer_count)) {
+      continue;
+    }
+    const int* slot_offsets = GetSlotOffsets(i);
+    if (CalculateMemoryPlanChecksum(slot_offsets, buffer_count) != slot->checksum) {
+      // Something has written over the slot, so it can't be trusted.
+      slot->last_used = 0;
+      break;
+    }
+    for (int j = 0; j < buffer_count; ++j) {
+      offsets[j] = slot_offsets[j];
+    }
+    slot->last_used = ++use_count_;
+    ++hit_count_;
+    return true;
+  }
+  if ((store_ != nullptr) && store_->LoadPlan(key, buffer_count, offsets)) {
+    StorePlan(key, offsets, buffer_count);
+    ++hit_count_;
+    return true;
+  }
+  ++miss_count_;
+  return false;
+}
+
+void MemoryPlanCache::AddPlan(const MemoryPlanKey& key, const int* offsets, const BufferRequirements* requirements, int buffer_count) {
+  StorePlan(key, offsets, buffer_count);
+  if (store_ != nullptr) {
+    store_->SavePlan(key, offsets, requirements, buffer_count);
+  }
+}
+
+void MemoryPlanCache::StorePlan(const MemoryPlanKey& key, const int* offsets, int buffer_count) {
+  if ((slot_count_ == 0) || (buffer_count > max_buffer_count_)) {
+    return;
+  }
+  int chosen_index = 0;
+  for (int i = 0; i < slot_count_; ++i) {
+    const SlotHeader* slot = GetSlot(i);
+    if ((slot->last_used != 0) && AreKeysEqual(slot->key, key)) {
+      chosen_index = i;
+      break;
+    }
+    if (slot->last_used < GetSlot(chosen_index)->last_used) {
+      chosen_index = i;
+    }
+  }
+  SlotHeader* slot = GetSlot(chosen_index);
+  int* slot_offsets = GetSlotOffsets(chosen_index);
+  for (int i = 0; i < buffer_count; ++i) {
+    slot_offsets[i] = offsets[i];
+  }
+  slot->key = key;
+  slot->buffer_count = buffer_count;
+  slot->checksum = CalculateMemoryPlanChecksum(offsets, buffer_count);
+  slot->last_used = ++use_count_;
+}
+
+}  // namespace tflite
@@ -0,0 +1,145 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_CACHE_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_CACHE_H_
+
+#include <cstdint>
+
+#include "memory_planner.h"
+
+namespace tflite {
+
+// Identifies the inputs a plan was made from. It's two independent 64-bit
+// hashes of the same data, so a plan is only used for different inputs if
+// both collide at once.
+struct MemoryPlanKey {
+  uint64_t hash;
+  uint64_t check;
+};
+
+// Builds a MemoryPlanKey from a sequence of ints. Planners add everything
+// their result depends on, including which kind of planner they are.
+class MemoryPlanHasher {
+ public:
+  MemoryPlanHasher();
+
+  void AddInt(int value);
+
+  MemoryPlanKey GetKey() const { return key_; }
+
+ private:
+  MemoryPlanKey key_;
+};
+
+// A checksum of a plan's offsets, used to spot plans that have been
+// corrupted since they were saved.
+uint32_t CalculateMemoryPlanChecksum(const int* offsets, int buffer_count);
+
+// Interface for somewhere plans can be kept between runs, like a directory
+// on disk. The cache only uses this after a lookup in memory fails, so it can
+// be slow.
+class MemoryPlanStore {
+ public:
+  MemoryPlanStore() {}
+  virtual ~MemoryPlanStore() {}
+
+  // Copies a saved plan with this key and buffer count into offsets, and
+  // returns true, or returns false if there isn't one. Implementations must
+  // check that the stored plan matches the checksum it was saved with.
+  virtual bool LoadPlan(const MemoryPlanKey& key, int buffer_count, int* offsets) = 0;
+
+  // Saves a plan, along with the requirements of the buffers it was made
+  // for. Failures are ignored, since the plan can always be calculated again.
+  virtual void SavePlan(const MemoryPlanKey& key, const int* offsets, const BufferRequirements* requirements, int buffer_count) = 0;
+};
+
+// Remembers recently calculated plans, so that planning the same buffers
+// again with the same options is just a copy of the offsets. Plans are kept
+// in a fixed number of slots in memory provided by the client, and when
+// they're all full the least recently used plan is replaced. Plans can also
+// be read from and written to a MemoryPlanStore, so they survive restarts.
+//
+// The cache doesn't know how plans were made. Planners that support it take
+// a pointer to one, compute the key, and check any plan they get back before
+// using it. One cache can be shared by several planners, as long as they
+// aren't planning at the same time.
+class MemoryPlanCache {
+ public:
+  // The storage must stay valid for the lifetime of the cache, and holds as
+  // many slots as fit, each with room for a plan of up to max_buffer_count
+  // buffers. The store is optional, and must outlive the cache if given.
+  MemoryPlanCache(unsigned char* storage, int storage_size, int max_buffer_count, MemoryPlanStore* store = nullptr);
+
+  // How many bytes of storage are needed to hold this many plans, including
+  // room for alignment.
+  static constexpr int GetStorageSize(int slot_count, int max_buffer_count) {
+    return (slot_count * GetSlotSize(max_buffer_count)) + (kStorageAlignment - 1);
+  }
+
+  // Copies the offsets of a plan with this key and buffer count, and returns
+  // true, or returns false if there isn't one. Plans found in the store are
+  // added to the cache in memory.
+  bool FindPlan(const MemoryPlanKey& key, int buffer_count, int* offsets);
+
+  // Records a plan, replacing any with the same key, and saves it to the
+  // store. Plans with more buffers than the slots hold are only saved to the
+  // store. The requirements are only passed on to the store, and aren't kept
+  // in memory.
+  void AddPlan(const MemoryPlanKey& key, const int* offsets, const BufferRequirements* requirements, int buffer_count);
+
+  // How many slots the storage has room for.
+  int GetSlotCount() const { return slot_count_; }
+
+  // How many lookups found a plan, and how many didn't.
+  int GetHitCount() const { return hit_count_; }
+  int GetMissCount() const { return miss_count_; }
+
+ private:
+  // What's stored at the start of every slot, before the offsets.
+  struct SlotHeader {
+    MemoryPlanKey key;
+    // When the slot was last used, from use_count_. Zero means it's empty.
+    uint64_t last_used;
+    int buffer_count;
+    uint32_t checksum;
+  };
+
+  static constexpr int kStorageAlignment = alignof(SlotHeader);
+
+  static constexpr int GetSlotSize(int max_buffer_count) {
+    return ((sizeof(SlotHeader) + (max_buffer_count * sizeof(int)) + (kStorageAlignment - 1)) / kStorageAlignment) * kStorageAlignment;
+  }
+
+  SlotHeader* GetSlot(int slot_index) const;
+  int* GetSlotOffsets(int slot_index) const;
+
+  // Copies a plan into memory, in the slot with the same key if there is
+  // one, or else the least recently used slot.
+  void StorePlan(const MemoryPlanKey& key, const int* offsets, int buffer_count);
+
+  unsigned char* storage_;
+  int slot_size_;
+  int slot_count_;
+  int max_buffer_count_;
+  MemoryPlanStore* store_;
+  uint64_t use_count_;
+  int hit_count_;
+  int miss_count_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_CACHE_H_
@@ -0,0 +1,275 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_plan_cache.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "file_memory_plan_store.h"
+#include "greedy_memory_planner.h"
+#include "micro_test.h"
+
+namespace {
+
+tflite::MemoryPlanKey MakeKey(int value) {
+  tflite::MemoryPlanHasher hasher;
+  hasher.AddInt(value);
+  return hasher.GetKey();
+}
+
+void AddTestBuffers(tflite::ErrorReporter* error_reporter, tflite::GreedyMemoryPlanner* planner) {
+  planner->AddBuffer(error_reporter, 100, 0, 1);
+  planner->AddBuffer(error_reporter, 50, 2, 3);
+  planner->AddBuffer(error_reporter, 50, 2, 3);
+  planner->AddBuffer(error_reporter, 20, 1, 2);
+  planner->AddBuffer(error_reporter, 120, 3, 5);
+}
+
+// Holds the last plan saved, in place of a real store.
+class SingleMemoryPlanStore : public tflite::MemoryPlanStore {
+ public:
+  SingleMemoryPlanStore() : buffer_count(0), match_any_key(false) {}
+
+  virtual bool LoadPlan(const tflite::MemoryPlanKey& key, int buffer_count, int* offsets) override {
+    const bool is_key_equal = (key.hash == this->key.hash) && (key.check == this->key.check);
+    if ((!is_key_equal && !match_any_key) || (buffer_count != this->buffer_count)) {
+      return false;
+    }
+    for (int i = 0; i < buffer_count; ++i) {
+      offsets[i] = this->offsets[i];
+    }
+    return true;
+  }
+
+  virtual void SavePlan(const tflite::MemoryPlanKey& key, const int* offsets, const tflite::BufferRequirements* requirements, int buffer_count) override {
+    this->key = key;
+    this->buffer_count = buffer_count;
+    for (int i = 0; i < buffer_count; ++i) {
+      this->offsets[i] = offsets[i];
+    }
+  }
+
+  tflite::MemoryPlanKey key;
+  int buffer_count;
+  int offsets[8];
+  // Returns the plan for every key, like a store with a hash collision.
+  bool match_any_key;
+};
+
+}  // namespace
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestMemoryPlanHasher) {
+  tflite::MemoryPlanHasher a;
+  tflite::MemoryPlanHasher b;
+  a.AddInt(1);
+  a.AddInt(2);
+  b.AddInt(2);
+  b.AddInt(1);
+  TF_LITE_MICRO_EXPECT(a.GetKey().hash != b.GetKey().hash);
+  TF_LITE_MICRO_EXPECT(a.GetKey().check != b.GetKey().check);
+  TF_LITE_MICRO_EXPECT(MakeKey(7).hash == MakeKey(7).hash);
+  TF_LITE_MICRO_EXPECT(MakeKey(7).check == MakeKey(7).check);
+}
+
+TF_LITE_MICRO_TEST(TestMemoryPlanCacheEviction) {
+  constexpr int storage_size = tflite::MemoryPlanCache::GetStorageSize(2, 4);
+  unsigned char storage[storage_size];
+  tflite::MemoryPlanCache cache(storage, storage_size, 4);
+  TF_LITE_MICRO_EXPECT_EQ(2, cache.GetSlotCount());
+
+  const int plans[3][4] = {{0, 1, 2, 3}, {10, 11, 12, 13}, {20, 21, 22, 23}};
+  const tflite::BufferRequirements requirements[4] = {{1, 0, 0, 1}, {1, 1, 1, 1}, {1, 2, 2, 1}, {1, 3, 3, 1}};
+  int offsets[4];
+  TF_LITE_MICRO_EXPECT_EQ(false, cache.FindPlan(MakeKey(0), 4, offsets));
+  cache.AddPlan(MakeKey(0), plans[0], requirements, 4);
+  cache.AddPlan(MakeKey(1), plans[1], requirements, 4);
+  // Using the first plan makes the second the least recently used, so it's
+  // the one replaced.
+  TF_LITE_MICRO_EXPECT_EQ(true, cache.FindPlan(MakeKey(0), 4, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(2, offsets[2]);
+  cache.AddPlan(MakeKey(2), plans[2], requirements, 4);
+  TF_LITE_MICRO_EXPECT_EQ(false, cache.FindPlan(MakeKey(1), 4, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(true, cache.FindPlan(MakeKey(2), 4, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(23, offsets[3]);
+  TF_LITE_MICRO_EXPECT_EQ(true, cache.FindPlan(MakeKey(0), 4, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(0, offsets[0]);
+  // The buffer count has to match too.
+  TF_LITE_MICRO_EXPECT_EQ(false, cache.FindPlan(MakeKey(0), 3, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(3, cache.GetHitCount());
+  TF_LITE_MICRO_EXPECT_EQ(3, cache.GetMissCount());
+
+  // Plans that have been written over aren't returned.
+  for (int i = 0; i < storage_size; ++i) {
+    if (storage[i] == 21) {
+      storage[i] = 99;
+    }
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, cache.FindPlan(MakeKey(2), 4, offsets));
+}
+
+TF_LITE_MICRO_TEST(TestGreedyPlanCache) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int storage_size = tflite::MemoryPlanCache::GetStorageSize(4, 8);
+  unsigned char storage[storage_size];
+  tflite::MemoryPlanCache cache(storage, storage_size, 8);
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(8);
+  unsigned char scratch_buffer[scratch_buffer_size];
+
+  tflite::GreedyMemoryPlanner first_planner(scratch_buffer, scratch_buffer_size);
+  first_planner.SetPlanCache(&cache);
+  AddTestBuffers(error_reporter, &first_planner);
+  const int arena_size = first_planner.GetMaximumMemorySize();
+  int expected_offsets[5];
+  for (int i = 0; i < 5; ++i) {
+    first_planner.GetOffsetForBuffer(error_reporter, i, &expected_offsets[i]);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(0, cache.GetHitCount());
+
+  // The same buffers and settings reuse the plan.
+  tflite::GreedyMemoryPlanner second_planner(scratch_buffer, scratch_buffer_size);
+  second_planner.SetPlanCache(&cache);
+  AddTestBuffers(error_reporter, &second_planner);
+  TF_LITE_MICRO_EXPECT_EQ(arena_size, second_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(1, cache.GetHitCount());
+  for (int i = 0; i < 5; ++i) {
+    int offset = -1;
+    second_planner.GetOffsetForBuffer(error_reporter, i, &offset);
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+
+  // Different settings need a new plan.
+  second_planner.SetGapSelectionPolicy(tflite::GreedyMemoryPlanner::kBestFit);
+  second_planner.GetMaximumMemorySize();
+  TF_LITE_MICRO_EXPECT_EQ(1, cache.GetHitCount());
+  TF_LITE_MICRO_EXPECT_EQ(2, cache.GetMissCount());
+}
+
+TF_LITE_MICRO_TEST(TestPlanCacheStore) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // A new cache in memory, as after a restart, finds plans in the store.
+  SingleMemoryPlanStore store;
+  constexpr int storage_size = tflite::MemoryPlanCache::GetStorageSize(1, 8);
+  unsigned char first_storage[storage_size];
+  tflite::MemoryPlanCache first_cache(first_storage, storage_size, 8, &store);
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(8);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner first_planner(scratch_buffer, scratch_buffer_size);
+  first_planner.SetPlanCache(&first_cache);
+  first_planner.SetRefinementIterations(3);
+  AddTestBuffers(error_reporter, &first_planner);
+  const int arena_size = first_planner.GetMaximumMemorySize();
+  TF_LITE_MICRO_EXPECT_EQ(5, store.buffer_count);
+
+  unsigned char second_storage[storage_size];
+  tflite::MemoryPlanCache second_cache(second_storage, storage_size, 8, &store);
+  tflite::GreedyMemoryPlanner second_planner(scratch_buffer, scratch_buffer_size);
+  second_planner.SetPlanCache(&second_cache);
+  second_planner.SetRefinementIterations(3);
+  AddTestBuffers(error_reporter, &second_planner);
+  TF_LITE_MICRO_EXPECT_EQ(arena_size, second_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(1, second_cache.GetHitCount());
+
+  // Plans that break a buffer's alignment are recalculated.
+  store.offsets[0] = 1;
+  store.match_any_key = true;
+  tflite::MemoryPlanCache third_cache(second_storage, storage_size, 8, &store);
+  tflite::GreedyMemoryPlanner third_planner(scratch_buffer, scratch_buffer_size);
+  third_planner.SetPlanCache(&third_cache);
+  third_planner.SetRefinementIterations(3);
+  third_planner.AddBuffer(error_reporter, 100, 0, 1, 16);
+  third_planner.AddBuffer(error_reporter, 50, 2, 3);
+  third_planner.AddBuffer(error_reporter, 50, 2, 3);
+  third_planner.AddBuffer(error_reporter, 20, 1, 2);
+  third_planner.AddBuffer(error_reporter, 120, 3, 5);
+  third_planner.GetMaximumMemorySize();
+  TF_LITE_MICRO_EXPECT_EQ(1, third_cache.GetHitCount());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, third_planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset % 16);
+
+  // So are plans that put buffers in use at the same time on top of each
+  // other, even if every offset is aligned.
+  for (int i = 0; i < 5; ++i) {
+    store.offsets[i] = 0;
+  }
+  tflite::MemoryPlanCache fourth_cache(second_storage, storage_size, 8, &store);
+  tflite::GreedyMemoryPlanner fourth_planner(scratch_buffer, scratch_buffer_size);
+  fourth_planner.SetPlanCache(&fourth_cache);
+  fourth_planner.SetRefinementIterations(3);
+  fourth_planner.AddBuffer(error_reporter, 100, 0, 1, 16);
+  fourth_planner.AddBuffer(error_reporter, 50, 2, 3);
+  fourth_planner.AddBuffer(error_reporter, 50, 2, 3);
+  fourth_planner.AddBuffer(error_reporter, 20, 1, 2);
+  fourth_planner.AddBuffer(error_reporter, 120, 3, 5);
+  TF_LITE_MICRO_EXPECT_EQ(true, fourth_planner.GetMaximumMemorySize() > 120);
+  TF_LITE_MICRO_EXPECT_EQ(1, fourth_cache.GetHitCount());
+  int first_offset = -1;
+  int second_offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, fourth_planner.GetOffsetForBuffer(error_reporter, 1, &first_offset));
+  TF_LITE_MICRO_EXPECT_EQ(true, fourth_planner.GetOffsetForBuffer(error_reporter, 2, &second_offset));
+  TF_LITE_MICRO_EXPECT_EQ(true, first_offset != second_offset);
+}
+
+TF_LITE_MICRO_TEST(TestFileMemoryPlanStore) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  const char* temporary_directory = getenv("TMPDIR");
+  char directory[tflite::FileMemoryPlanStore::kMaxPathLength];
+  snprintf(directory, sizeof(directory), "%s/memory_plan_cache_test.XXXXXX", (temporary_directory != nullptr) ? temporary_directory : "/tmp");
+  TF_LITE_MICRO_EXPECT(mkdtemp(directory) != nullptr);
+
+  constexpr int buffer_size = tflite::FileMemoryPlanStore::GetBufferSize(3);
+  unsigned char buffer[buffer_size];
+  tflite::FileMemoryPlanStore store(error_reporter, directory, buffer, buffer_size);
+  const tflite::MemoryPlanKey key = MakeKey(12345);
+  const int plan[3] = {0, 64, 128};
+  const tflite::BufferRequirements requirements[3] = {{64, 0, 1, 1}, {64, 1, 2, 1}, {32, 0, 2, 1}};
+  store.SavePlan(key, plan, requirements, 3);
+  int offsets[3] = {-1, -1, -1};
+  TF_LITE_MICRO_EXPECT_EQ(true, store.LoadPlan(key, 3, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(128, offsets[2]);
+  TF_LITE_MICRO_EXPECT_EQ(false, store.LoadPlan(key, 2, offsets));
+  TF_LITE_MICRO_EXPECT_EQ(false, store.LoadPlan(MakeKey(54321), 3, offsets));
+
+  // The file is an ordinary serialized plan, with the buffers' requirements.
+  char path[tflite::FileMemoryPlanStore::kMaxPathLength + 48];
+  snprintf(path, sizeof(path), "%s/%016llx%016llx.tflmplan", directory, static_cast<unsigned long long>(key.hash), static_cast<unsigned long long>(key.check));
+  unsigned char file_data[buffer_size];
+  FILE* file = fopen(path, "rb");
+  TF_LITE_MICRO_EXPECT(file != nullptr);
+  const int file_size = static_cast<int>(fread(file_data, 1, sizeof(file_data), file));
+  fclose(file);
+  tflite::MemoryPlanReader reader;
+  TF_LITE_MICRO_EXPECT_EQ(true, reader.Initialize(error_reporter, file_data, file_size));
+  TF_LITE_MICRO_EXPECT_EQ(160, reader.GetArenaSize());
+  tflite::BufferRequirements loaded_requirements;
+  reader.GetRequirements(2, &loaded_requirements);
+  TF_LITE_MICRO_EXPECT_EQ(32, loaded_requirements.size);
+
+  remove(path);
+  TF_LITE_MICRO_EXPECT_EQ(0, rmdir(directory));
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -0,0 +1,186 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_plan_serialization.h"
+
+namespace tflite {
+namespace {
+
+constexpr uint32_t kMagic = 0x4c504654;  // "TFPL" in little-endian.
+
+// Byte positions of the header fields.
+constexpr int kMagicPosition = 0;
+constexpr int kVersionPosition = 4;
+constexpr int kBufferCountPosition = 8;
+constexpr int kArenaSizePosition = 12;
+constexpr int kChecksumPosition = 16;
+constexpr int kReservedPosition = 20;
+constexpr int kOffsetsPosition = 24;
+
+// Each buffer's requirements take four words.
+constexpr int kRequirementsSize = 16;
+
+// The standard 32-bit FNV-1a parameters.
+constexpr uint32_t kFnvOffsetBasis = 0x811c9dc5;
+constexpr uint32_t kFnvPrime = 0x01000193;
+
+// The format is always little-endian, so values are assembled byte by byte.
+// Compilers turn these into plain loads and stores on little-endian machines.
+void WriteWord(unsigned char* data, int position, int32_t value) {
+  const uint32_t bits = static_cast<uint32_t>(value);
+  data[position] = bits & 0xff;
+  data[position + 1] = (bits >> 8) & 0xff;
+  data[position + 2] = (bits >> 16) & 0xff;
+  data[position + 3] = (bits >> 24) & 0xff;
+}
+
+int32_t ReadWord(const unsigned char* data, int position) {
+  const uint32_t bits = static_cast<uint32_t>(data[position]) | (static_cast<uint32_t>(data[position + 1]) << 8) | (static_cast<uint32_t>(data[position + 2]) << 16) | (static_cast<uint32_t>(data[position + 3]) << 24);
+  return static_cast<int32_t>(bits);
+}
+
+uint32_t HashBytes(uint32_t hash, const unsigned char* data, int start, int end) {
+  for (int i = start; i < end; ++i) {
+    hash ^= data[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+// Covers everything but the checksum field itself.
+uint32_t CalculateChecksum(const unsigned char* data, int size) {
+  const uint32_t hash = HashBytes(kFnvOffsetBasis, data, 0, kChecksumPosition);
+  return HashBytes(hash, data, kChecksumPosition + 4, size);
+}
+
+void WriteBuffer(unsigned char* data, int buffer_count, int buffer_index, int offset, const BufferRequirements& requirements) {
+  WriteWord(data, kOffsetsPosition + (buffer_index * 4), offset);
+  const int position = kOffsetsPosition + (buffer_count * 4) + (buffer_index * kRequirementsSize);
+  WriteWord(data, position, requirements.size);
+  WriteWord(data, position + 4, requirements.first_time_used);
+  WriteWord(data, position + 8, requirements.last_time_used);
+  WriteWord(data, position + 12, requirements.alignment);
+}
+
+// Fills in the header once every buffer has been written, since the
+// checksum covers them.
+void WriteHeader(unsigned char* data, int buffer_count, int arena_size, int size) {
+  WriteWord(data, kMagicPosition, kMagic);
+  WriteWord(data, kVersionPosition, kMemoryPlanFormatVersion);
+  WriteWord(data, kBufferCountPosition, buffer_count);
+  WriteWord(data, kArenaSizePosition, arena_size);
+  WriteWord(data, kReservedPosition, 0);
+  WriteWord(data, kChecksumPosition, CalculateChecksum(data, size));
+}
+
+}  // namespace
+
+MemoryPlanWriter::MemoryPlanWriter(unsigned char* buffer, int buffer_size) : buffer_(buffer), buffer_size_(buffer_size), written_size_(0) {}
+
+bool MemoryPlanWriter::Write(ErrorReporter* error_reporter, MemoryPlanner* planner, const BufferRequirements* requirements, int buffer_count) {
+  if (planner->GetBufferCount() != buffer_count) {
+    error_reporter->Report("Planner has %d buffers, but %d were given", planner->GetBufferCount(), buffer_count);
+    return false;
+  }
+  if (!HasRoomFor(error_reporter, buffer_count)) {
+    return false;
+  }
+  for (int i = 0; i < buffer_count; ++i) {
+    int offset;
+    if (!planner->GetOffsetForBuffer(error_reporter, i, &offset)) {
+      return false;
+    }
+    WriteBuffer(buffer_, buffer_count, i, offset, requirements[i]);
+  }
+  const int size = GetSerializedSize(buffer_count);
+  WriteHeader(buffer_, buffer_count, planner->GetMaximumMemorySize(), size);
+  written_size_ = size;
+  return true;
+}
+
+bool MemoryPlanWriter::Write(ErrorReporter* error_reporter, const int* offsets, const BufferRequirements* requirements, int buffer_count) {
+  if (!HasRoomFor(error_reporter, buffer_count)) {
+    return false;
+  }
+  int arena_size = 0;
+  for (int i = 0; i < buffer_count; ++i) {
+    WriteBuffer(buffer_, buffer_count, i, offsets[i], requirements[i]);
+    if ((offsets[i] + requirements[i].size) > arena_size) {
+      arena_size = offsets[i] + requirements[i].size;
+    }
+  }
+  const int size = GetSerializedSize(buffer_count);
+  WriteHeader(buffer_, buffer_count, arena_size, size);
+  written_size_ = size;
+  return true;
+}
+
+bool MemoryPlanWriter::HasRoomFor(ErrorReporter* error_reporter, int buffer_count) const {
+  const int size = GetSerializedSize(buffer_count);
+  if (size > buffer_size_) {
+    error_reporter->Report("Serialized plan needs %d bytes, but only %d are available", size, buffer_size_);
+    return false;
+  }
+  return true;
+}
+
+MemoryPlanReader::MemoryPlanReader() : data_(nullptr), buffer_count_(0), arena_size_(0) {}
+
+bool MemoryPlanReader::Initialize(ErrorReporter* error_reporter, const unsigned char* data, int data_size) {
+  data_ = nullptr;
+  buffer_count_ = 0;
+  arena_size_ = 0;
+  if (data_size < MemoryPlanWriter::GetSerializedSize(0)) {
+    error_reporter->Report("Serialized plan is too small to hold a header");
+    return false;
+  }
+  if (static_cast<uint32_t>(ReadWord(data, kMagicPosition)) != kMagic) {
+    error_reporter->Report("Data isn't a serialized plan");
+    return false;
+  }
+  const uint32_t version = ReadWord(data, kVersionPosition);
+  if (version != kMemoryPlanFormatVersion) {
+    error_reporter->Report("Serialized plan version %d isn't supported (expected %d)", version, kMemoryPlanFormatVersion);
+    return false;
+  }
+  // Make sure the count can't overflow the size calculation.
+  const int buffer_count = ReadWord(data, kBufferCountPosition);
+  const int max_buffer_count = (data_size - MemoryPlanWriter::GetSerializedSize(0)) / (MemoryPlanWriter::GetSerializedSize(1) - MemoryPlanWriter::GetSerializedSize(0));
+  if ((buffer_count < 0) || (buffer_count > max_buffer_count)) {
+    error_reporter->Report("Serialized plan with %d buffers doesn't fit in %d bytes", buffer_count, data_size);
+    return false;
+  }
+  const int size = MemoryPlanWriter::GetSerializedSize(buffer_count);
+  if (static_cast<uint32_t>(ReadWord(data, kChecksumPosition)) != CalculateChecksum(data, size)) {
+    error_reporter->Report("Serialized plan checksum doesn't match");
+    return false;
+  }
+  data_ = data;
+  buffer_count_ = buffer_count;
+  arena_size_ = ReadWord(data, kArenaSizePosition);
+  return true;
+}
+
+int MemoryPlanReader::GetOffset(int buffer_index) const { return ReadWord(data_, kOffsetsPosition + (buffer_index * 4)); }
+
+void MemoryPlanReader::GetRequirements(int buffer_index, BufferRequirements* requirements) const {
+  const int position = kOffsetsPosition + (buffer_count_ * 4) + (buffer_index * MemoryPlanWriter::kRequirementsWordCount * 4);
+  requirements->size = ReadWord(data_, position);
+  requirements->first_time_used = ReadWord(data_, position + 4);
+  requirements->last_time_used = ReadWord(data_, position + 8);
+  requirements->alignment = ReadWord(data_, position + 12);
+}
+
+}  // namespace tflite
@@ -0,0 +1,109 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_SERIALIZATION_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_SERIALIZATION_H_
+
+#include <cstdint>
+
+#include "memory_planner.h"
+
+namespace tflite {
+
+// A binary format for saving plans, so a runtime can skip planning and use
+// the offsets straight from a file that's been mapped into memory.
+//
+// Every field is a 32-bit little-endian integer, laid out like this:
+//   magic         "TFPL"
+//   version       kMemoryPlanFormatVersion
+//   buffer_count  n
+//   arena_size    GetMaximumMemorySize() of the plan
+//   checksum      32-bit FNV-1a of every byte of the plan except this field
+//   reserved      zero
+//   offsets       n entries, one per buffer
+//   requirements  n entries of size, first_time_used, last_time_used, and
+//                 alignment
+//
+// The offsets come straight after the fixed-size header, so reading one is a
+// single load at a known position, with nothing to parse first. The
+// requirements are there to check that a plan matches the model it's loaded
+// for, and to verify or re-plan it offline.
+constexpr uint32_t kMemoryPlanFormatVersion = 1;
+
+// Writes plans in the serialized format into a buffer provided by the client.
+class MemoryPlanWriter {
+ public:
+  MemoryPlanWriter(unsigned char* buffer, int buffer_size);
+
+  // How many bytes a plan with this many buffers takes.
+  static constexpr int GetSerializedSize(int buffer_count) {
+    return (kHeaderWordCount + (buffer_count * (1 + kRequirementsWordCount))) * 4;
+  }
+
+  // Writes the plan for a set of buffers, with the offsets and arena size
+  // from a planner they've all been added to. Returns false if the buffer is
+  // too small, or the planner doesn't hold buffer_count buffers.
+  bool Write(ErrorReporter* error_reporter, MemoryPlanner* planner, const BufferRequirements* requirements, int buffer_count);
+
+  // Writes a plan from offsets that have already been calculated, such as
+  // ones kept by a MemoryPlanCache. The arena size is taken to be the end of
+  // the highest buffer. Returns false if the buffer is too small.
+  bool Write(ErrorReporter* error_reporter, const int* offsets, const BufferRequirements* requirements, int buffer_count);
+
+  // How many bytes the last successful Write() used.
+  int GetWrittenSize() const { return written_size_; }
+
+ private:
+  friend class MemoryPlanReader;
+
+  static constexpr int kHeaderWordCount = 6;
+  static constexpr int kRequirementsWordCount = 4;
+
+  // Whether a plan with this many buffers fits in the buffer.
+  bool HasRoomFor(ErrorReporter* error_reporter, int buffer_count) const;
+
+  unsigned char* buffer_;
+  int buffer_size_;
+  int written_size_;
+};
+
+// Reads a serialized plan in place, without copying it.
+class MemoryPlanReader {
+ public:
+  MemoryPlanReader();
+
+  // Checks that the data holds a complete plan in a version this code
+  // understands, with a matching checksum. The data isn't copied, so it must
+  // stay valid while the reader is used. None of the other methods can be
+  // called unless this returns true.
+  bool Initialize(ErrorReporter* error_reporter, const unsigned char* data, int data_size);
+
+  int GetBufferCount() const { return buffer_count_; }
+  int GetArenaSize() const { return arena_size_; }
+
+  // These don't check the buffer index, so it must be less than
+  // GetBufferCount().
+  int GetOffset(int buffer_index) const;
+  void GetRequirements(int buffer_index, BufferRequirements* requirements) const;
+
+ private:
+  const unsigned char* data_;
+  int buffer_count_;
+  int arena_size_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_SERIALIZATION_H_
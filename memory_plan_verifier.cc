@@ -0,0 +1,193 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_plan_verifier.h"
+
+#include <cstdint>
+
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+namespace {
+
+// The live buffers are tracked by their position in offset order, in a
+// Fenwick tree that counts how many are live at each position. That gives an
+// ordered set with O(log n) insertion, removal and neighbor lookups, in a
+// fixed amount of memory.
+class LiveBufferSet {
+ public:
+  LiveBufferSet(int* counts, int size) : counts_(counts), size_(size), live_count_(0) {
+    for (int i = 0; i <= size_; ++i) {
+      counts_[i] = 0;
+    }
+  }
+
+  void Add(int position, int change) {
+    live_count_ += change;
+    for (int i = position + 1; i <= size_; i += (i & -i)) {
+      counts_[i] += change;
+    }
+  }
+
+  // How many live buffers are before this position.
+  int CountBefore(int position) const {
+    int count = 0;
+    for (int i = position; i > 0; i -= (i & -i)) {
+      count += counts_[i];
+    }
+    return count;
+  }
+
+  // The position of the live buffer with this many live ones before it.
+  int FindPosition(int live_index) const {
+    int position = 0;
+    int step = 1;
+    while ((step * 2) <= size_) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      if (((position + step) <= size_) && (counts_[position + step] <= live_index)) {
+        position += step;
+        live_index -= counts_[position];
+      }
+    }
+    return position;
+  }
+
+  // The nearest live positions on either side of this one, or -1.
+  int FindPrevious(int position) const {
+    const int count = CountBefore(position);
+    return (count > 0) ? FindPosition(count - 1) : -1;
+  }
+  int FindNext(int position) const {
+    const int count = CountBefore(position + 1);
+    return (count < live_count_) ? FindPosition(count) : -1;
+  }
+
+ private:
+  int* counts_;
+  int size_;
+  int live_count_;
+};
+
+bool DoBuffersOverlap(const BufferRequirements* requirements, const int* offsets, int lower_id, int upper_id) {
+  return (static_cast<int64_t>(offsets[lower_id]) + requirements[lower_id].size) > offsets[upper_id];
+}
+
+}  // namespace
+
+bool VerifyMemoryPlan(ErrorReporter* error_reporter, const BufferRequirements* requirements, const int* offsets, int buffer_count, int arena_size, int* scratch) {
+  for (int i = 0; i < buffer_count; ++i) {
+    const BufferRequirements& current = requirements[i];
+    if ((current.size < 0) || (current.last_time_used < current.first_time_used)) {
+      error_reporter->Report("Buffer %d has size %d and is used from %d to %d", i, current.size, current.first_time_used, current.last_time_used);
+      return false;
+    }
+    if ((offsets[i] < 0) || ((static_cast<int64_t>(offsets[i]) + current.size) > arena_size)) {
+      error_reporter->Report("Buffer %d at offset %d with size %d is outside the arena of %d bytes", i, offsets[i], current.size, arena_size);
+      return false;
+    }
+    if (!IsValidBufferAlignment(current.alignment) || (AlignOffset(offsets[i], current.alignment) != offsets[i])) {
+      error_reporter->Report("Buffer %d at offset %d isn't aligned to %d bytes", i, offsets[i], current.alignment);
+      return false;
+    }
+  }
+
+  if (buffer_count == 0) {
+    return true;
+  }
+  int* ids_by_offset = scratch;
+  int* positions = ids_by_offset + buffer_count;
+  int* first_ids = positions + buffer_count;
+  int* last_ids = first_ids + buffer_count;
+  int* sort_values = last_ids + buffer_count;
+  int* sort_scratch_values = sort_values + buffer_count;
+  int* sort_scratch_ids = sort_scratch_values + buffer_count;
+  // The sorts are finished with their scratch memory by the time the sweep
+  // needs the live set, which takes buffer_count + 1 ints.
+  int* live_counts = sort_scratch_values;
+
+  // Number the buffers in offset order. The sort is stable, so buffers at
+  // the same offset get different positions.
+  for (int i = 0; i < buffer_count; ++i) {
+    sort_values[i] = offsets[i];
+    ids_by_offset[i] = i;
+  }
+  SortWithScratch(sort_values, ids_by_offset, buffer_count, sort_scratch_values, sort_scratch_ids);
+  for (int position = 0; position < buffer_count; ++position) {
+    positions[ids_by_offset[position]] = position;
+  }
+
+  for (int i = 0; i < buffer_count; ++i) {
+    sort_values[i] = requirements[i].first_time_used;
+    first_ids[i] = i;
+  }
+  SortWithScratch(sort_values, first_ids, buffer_count, sort_scratch_values, sort_scratch_ids);
+  for (int i = 0; i < buffer_count; ++i) {
+    sort_values[i] = requirements[i].last_time_used;
+    last_ids[i] = i;
+  }
+  SortWithScratch(sort_values, last_ids, buffer_count, sort_scratch_values, sort_scratch_ids);
+
+  // As long as the live buffers don't overlap each other, a new one can only
+  // overlap one of them if it overlaps its nearest neighbor below or above.
+  // Empty buffers can't overlap anything, so they're left out.
+  LiveBufferSet live_buffers(live_counts, buffer_count);
+  int next_last = 0;
+  for (int i = 0; i < buffer_count; ++i) {
+    const int time = requirements[first_ids[i]].first_time_used;
+    while ((next_last < buffer_count) && (requirements[last_ids[next_last]].last_time_used < time)) {
+      const int finished_id = last_ids[next_last];
+      if (requirements[finished_id].size > 0) {
+        live_buffers.Add(positions[finished_id], -1);
+      }
+      ++next_last;
+    }
+    const int buffer_id = first_ids[i];
+    if (requirements[buffer_id].size == 0) {
+      continue;
+    }
+    const int position = positions[buffer_id];
+    const int previous = live_buffers.FindPrevious(position);
+    if ((previous != -1) && DoBuffersOverlap(requirements, offsets, ids_by_offset[previous], buffer_id)) {
+      error_reporter->Report("Buffers %d and %d overlap in memory and are both in use at time %d", ids_by_offset[previous], buffer_id, time);
+      return false;
+    }
+    const int next = live_buffers.FindNext(position);
+    if ((next != -1) && DoBuffersOverlap(requirements, offsets, buffer_id, ids_by_offset[next])) {
+      error_reporter->Report("Buffers %d and %d overlap in memory and are both in use at time %d", buffer_id, ids_by_offset[next], time);
+      return false;
+    }
+    live_buffers.Add(position, 1);
+  }
+  return true;
+}
+
+bool VerifyMemoryPlan(ErrorReporter* error_reporter, MemoryPlanner* planner, const BufferRequirements* requirements, int buffer_count, int* scratch) {
+  if (planner->GetBufferCount() != buffer_count) {
+    error_reporter->Report("Plan has %d buffers, but %d were expected", planner->GetBufferCount(), buffer_count);
+    return false;
+  }
+  // The offsets go after the memory the other version of the check uses.
+  int* offsets = scratch + GetVerifyOffsetsScratchCount(buffer_count);
+  for (int i = 0; i < buffer_count; ++i) {
+    if (!planner->GetOffsetForBuffer(error_reporter, i, &offsets[i])) {
+      return false;
+    }
+  }
+  return VerifyMemoryPlan(error_reporter, requirements, offsets, buffer_count, planner->GetMaximumMemorySize(), scratch);
+}
+
+}  // namespace tflite
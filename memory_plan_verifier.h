@@ -0,0 +1,50 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_VERIFIER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_VERIFIER_H_
+
+#include "error_reporter.h"
+#include "memory_planner.h"
+
+namespace tflite {
+
+// How many ints of scratch memory VerifyMemoryPlan() needs to check an array
+// of offsets.
+constexpr int GetVerifyOffsetsScratchCount(int buffer_count) { return buffer_count * 7; }
+
+// How many ints of scratch memory either version of VerifyMemoryPlan() needs,
+// including room to read the offsets from a planner.
+constexpr int GetVerifyMemoryPlanScratchCount(int buffer_count) { return buffer_count * 8; }
+
+// Checks that a plan is safe to use for these buffers, for example after
+// loading it from a cache or a file. Every buffer has to be aligned, lie
+// inside the arena, and not share any memory with another buffer that's in
+// use at the same time. The first problem found is reported and false is
+// returned. Buffers are swept through in order of first use, and the live
+// ones are kept in an ordered set by offset, so only neighbors in that set
+// need comparing and the check takes O(n log n) time rather than comparing
+// every pair. The scratch array must hold
+// GetVerifyOffsetsScratchCount(buffer_count) ints.
+bool VerifyMemoryPlan(ErrorReporter* error_reporter, const BufferRequirements* requirements, const int* offsets, int buffer_count, int arena_size, int* scratch);
+
+// The same checks for the plan a planner has made. The requirements must
+// describe the planner's buffers, in the order they were added, and the
+// scratch array must hold GetVerifyMemoryPlanScratchCount(buffer_count) ints.
+bool VerifyMemoryPlan(ErrorReporter* error_reporter, MemoryPlanner* planner, const BufferRequirements* requirements, int buffer_count, int* scratch);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_MEMORY_PLAN_VERIFIER_H_
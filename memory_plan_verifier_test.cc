@@ -0,0 +1,129 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "memory_plan_verifier.h"
+#include "greedy_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestVerifyMemoryPlan) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  const tflite::BufferRequirements requirements[] = {
+      {100, 0, 1, 1},
+      {50, 1, 2, 1},
+      {30, 2, 3, 16},
+      {0, 1, 3, 1},
+  };
+  int scratch[tflite::GetVerifyMemoryPlanScratchCount(4)];
+  const int valid_offsets[] = {0, 100, 0, 40};
+  TF_LITE_MICRO_EXPECT_EQ(true, tflite::VerifyMemoryPlan(error_reporter, requirements, valid_offsets, 4, 150, scratch));
+  // Empty buffers don't take up any memory, so others can cover them.
+  const int reused_offsets[] = {0, 100, 32, 40};
+  TF_LITE_MICRO_EXPECT_EQ(true, tflite::VerifyMemoryPlan(error_reporter, requirements, reused_offsets, 4, 150, scratch));
+
+  const int overlapping_offsets[] = {0, 99, 0, 40};
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, requirements, overlapping_offsets, 4, 150, scratch));
+  const int same_offsets[] = {0, 100, 100, 40};
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, requirements, same_offsets, 4, 150, scratch));
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, requirements, valid_offsets, 4, 149, scratch));
+  const int negative_offsets[] = {0, 100, -16, 40};
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, requirements, negative_offsets, 4, 150, scratch));
+  const int misaligned_offsets[] = {0, 100, 8, 40};
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, requirements, misaligned_offsets, 4, 150, scratch));
+  TF_LITE_MICRO_EXPECT_EQ(true, tflite::VerifyMemoryPlan(error_reporter, requirements, valid_offsets, 0, 0, scratch));
+}
+
+TF_LITE_MICRO_TEST(TestVerifyPlannerPlan) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 500;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  static tflite::BufferRequirements requirements[buffer_count];
+  static int scratch[tflite::GetVerifyMemoryPlanScratchCount(buffer_count)];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    requirements[i].size = (seed >> 16) % 1000;
+    seed = (seed * 1103515245) + 12345;
+    requirements[i].first_time_used = (seed >> 16) % 200;
+    seed = (seed * 1103515245) + 12345;
+    requirements[i].last_time_used = requirements[i].first_time_used + ((seed >> 16) % 20);
+    requirements[i].alignment = 8;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, requirements[i].size, requirements[i].first_time_used, requirements[i].last_time_used, requirements[i].alignment));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, tflite::VerifyMemoryPlan(error_reporter, &planner, requirements, buffer_count, scratch));
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, &planner, requirements, buffer_count - 1, scratch));
+
+  // A buffer that grew since the plan was made may now overlap another.
+  requirements[0].size += 1000;
+  TF_LITE_MICRO_EXPECT_EQ(false, tflite::VerifyMemoryPlan(error_reporter, &planner, requirements, buffer_count, scratch));
+}
+
+TF_LITE_MICRO_TEST(TestVerifyMatchesPairwiseCheck) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Random plans, some valid and some not, checked against comparing every
+  // pair of buffers.
+  constexpr int buffer_count = 40;
+  tflite::BufferRequirements requirements[buffer_count];
+  int offsets[buffer_count];
+  int scratch[tflite::GetVerifyMemoryPlanScratchCount(buffer_count)];
+  unsigned int seed = 1;
+  int valid_count = 0;
+  bool all_match = true;
+  for (int plan = 0; plan < 200; ++plan) {
+    for (int i = 0; i < buffer_count; ++i) {
+      seed = (seed * 1103515245) + 12345;
+      requirements[i].size = (seed >> 16) % 64;
+      seed = (seed * 1103515245) + 12345;
+      requirements[i].first_time_used = (seed >> 16) % 100;
+      seed = (seed * 1103515245) + 12345;
+      requirements[i].last_time_used = requirements[i].first_time_used + ((seed >> 16) % 3);
+      requirements[i].alignment = 1;
+      seed = (seed * 1103515245) + 12345;
+      offsets[i] = (seed >> 16) % 512;
+    }
+    bool is_valid = true;
+    for (int i = 0; i < buffer_count; ++i) {
+      for (int j = 0; j < i; ++j) {
+        const bool share_time = (requirements[i].first_time_used <= requirements[j].last_time_used) && (requirements[j].first_time_used <= requirements[i].last_time_used);
+        const bool are_empty = (requirements[i].size == 0) || (requirements[j].size == 0);
+        const bool share_memory = !are_empty && (offsets[i] < (offsets[j] + requirements[j].size)) && (offsets[j] < (offsets[i] + requirements[i].size));
+        if (share_time && share_memory) {
+          is_valid = false;
+        }
+      }
+    }
+    if (is_valid) {
+      ++valid_count;
+    }
+    if (tflite::VerifyMemoryPlan(error_reporter, requirements, offsets, buffer_count, 576, scratch) != is_valid) {
+      all_match = false;
+    }
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, all_match);
+  TF_LITE_MICRO_EXPECT_EQ(true, valid_count > 0);
+  TF_LITE_MICRO_EXPECT_EQ(true, valid_count < 200);
+}
+
+TF_LITE_MICRO_TESTS_END
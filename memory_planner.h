@@ -20,6 +20,24 @@ limitations under the License.
 
 namespace tflite {
 
+// The alignment buffers get if none is given, which allows any offset.
+constexpr int kDefaultBufferAlignment = 1;
+
+// Records the client-provided information about a buffer.
+struct BufferRequirements {
+  int size;
+  int first_time_used;
+  int last_time_used;
+  int alignment;
+};
+
+// Whether an alignment can be used for a buffer, which means it's a positive
+// power of two.
+constexpr bool IsValidBufferAlignment(int alignment) { return (alignment > 0) && ((alignment & (alignment - 1)) == 0); }
+
+// Rounds an offset up to the next multiple of a valid alignment.
+constexpr int AlignOffset(int offset, int alignment) { return (offset + (alignment - 1)) & ~(alignment - 1); }
+
 // Interface class for planning the layout of memory buffers during the execution
 // of a graph. 
 class MemoryPlanner {
@@ -29,6 +47,20 @@ class MemoryPlanner {
 
   virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) = 0;
 
+  // Adds a buffer whose offset must be a multiple of alignment, for example so
+  // that SIMD kernels can use aligned loads. The alignment must be a power of
+  // two. Each aligned buffer can leave up to alignment - 1 unused bytes below
+  // it, so the arena can grow by that much for every buffer that's active at
+  // the peak. Planners that don't support alignment only need to provide the
+  // version above, and this reports an error for anything but the default.
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+    if (alignment != kDefaultBufferAlignment) {
+      error_reporter->Report("This planner doesn't support buffer alignment %d", alignment);
+      return false;
+    }
+    return AddBuffer(error_reporter, size, first_time_used, last_time_used);
+  }
+
   virtual int GetMaximumMemorySize() = 0;
   virtual int GetBufferCount() = 0;
   virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) = 0;
@@ -0,0 +1,579 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures how long the memory planners take to lay out synthetic graphs of
+// different sizes, and how large the resulting arenas are. This needs a host
+// machine with <chrono> and a heap for the scratch memory, so unlike the tests
+// it isn't meant to run on devices.
+
+#include <chrono>
+#include <cstdint>
+
+#include "greedy_memory_planner.h"
+#include "memory_plan_verifier.h"
+#include "micro_error_reporter.h"
+#include "segmented_memory_planner.h"
+#include "skyline_memory_planner.h"
+#include "streaming_memory_planner.h"
+#include "symbolic_memory_planner.h"
+#include "thread_task_runner.h"
+#include "time_overlap_mask.h"
+
+namespace {
+
+// Simple deterministic pseudo-random generator, so runs are comparable.
+int NextRandom(unsigned int* seed, int range) {
+  *seed = (*seed * 1103515245) + 12345;
+  return (*seed >> 8) % range;
+}
+
+// Adds buffers that look roughly like the activations of a long model. Most
+// are only alive for a few steps, but some are kept around much longer, like
+// skip connections.
+void AddSyntheticGraphOverTimeSteps(tflite::ErrorReporter* error_reporter, tflite::MemoryPlanner* planner, int buffer_count, int time_steps, unsigned int seed) {
+  for (int i = 0; i < buffer_count; ++i) {
+    const int size = (NextRandom(&seed, 64) + 1) * 1024;
+    const int first_time_used = NextRandom(&seed, time_steps);
+    int lifetime = NextRandom(&seed, 4);
+    if (NextRandom(&seed, 20) == 0) {
+      lifetime += NextRandom(&seed, 100);
+    }
+    planner->AddBuffer(error_reporter, size, first_time_used, first_time_used + lifetime);
+  }
+}
+
+// A synthetic graph with about two buffers per time step.
+void AddSyntheticGraph(tflite::ErrorReporter* error_reporter, tflite::MemoryPlanner* planner, int buffer_count, unsigned int seed) {
+  AddSyntheticGraphOverTimeSteps(error_reporter, planner, buffer_count, (buffer_count / 2) + 1, seed);
+}
+
+// How many times each measurement is repeated. The fastest run is reported,
+// since that's the least affected by other activity on the machine.
+constexpr int kRepeatCount = 5;
+
+// Microseconds taken to plan the graph, measured by asking for the arena size.
+// Works with any planner that's built from a scratch buffer sized by its
+// GetScratchBufferSize().
+template <typename PlannerType>
+int TimePlanning(tflite::ErrorReporter* error_reporter, int buffer_count, int* arena_size) {
+  const int scratch_buffer_size = PlannerType::GetScratchBufferSize(buffer_count);
+  unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+  int best_microseconds = 0;
+  for (int i = 0; i < kRepeatCount; ++i) {
+    PlannerType planner(scratch_buffer, scratch_buffer_size);
+    AddSyntheticGraph(error_reporter, &planner, buffer_count, 1);
+    const auto start = std::chrono::steady_clock::now();
+    *arena_size = planner.GetMaximumMemorySize();
+    const auto end = std::chrono::steady_clock::now();
+    const int microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if ((i == 0) || (microseconds < best_microseconds)) {
+      best_microseconds = microseconds;
+    }
+  }
+  delete[] scratch_buffer;
+  return best_microseconds;
+}
+
+// Compares the skyline and greedy planners on graphs with many buffers in use
+// at each time step, where the greedy planner has to search long lists of
+// active buffers for gaps.
+void CompareSkylineOnDenseGraphs(tflite::ErrorReporter* error_reporter) {
+  const int buffer_counts[] = {10000, 100000};
+  for (int buffer_count : buffer_counts) {
+    const int time_step_count = buffer_count / 50;
+    const int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+    const int skyline_scratch_buffer_size = tflite::SkylineMemoryPlanner::GetScratchBufferSize(buffer_count);
+    unsigned char* greedy_scratch_buffer = new unsigned char[greedy_scratch_buffer_size];
+    unsigned char* skyline_scratch_buffer = new unsigned char[skyline_scratch_buffer_size];
+    tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+    tflite::SkylineMemoryPlanner skyline_planner(skyline_scratch_buffer, skyline_scratch_buffer_size);
+    AddSyntheticGraphOverTimeSteps(error_reporter, &greedy_planner, buffer_count, time_step_count, 1);
+    AddSyntheticGraphOverTimeSteps(error_reporter, &skyline_planner, buffer_count, time_step_count, 1);
+    const auto greedy_start = std::chrono::steady_clock::now();
+    const int greedy_arena_size = greedy_planner.GetMaximumMemorySize();
+    const auto skyline_start = std::chrono::steady_clock::now();
+    const int skyline_arena_size = skyline_planner.GetMaximumMemorySize();
+    const auto end = std::chrono::steady_clock::now();
+    const int greedy_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(skyline_start - greedy_start).count();
+    const int skyline_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - skyline_start).count();
+    error_reporter->Report("Dense graph, %d buffers over %d steps: skyline %d us, arena size %d, greedy %d us, arena size %d", buffer_count, time_step_count, skyline_microseconds, skyline_arena_size, greedy_microseconds, greedy_arena_size);
+    delete[] greedy_scratch_buffer;
+    delete[] skyline_scratch_buffer;
+  }
+}
+
+// Adds a long sequential model made of blocks that don't share any buffers,
+// so it can be split at every block boundary.
+void AddSequentialModel(tflite::ErrorReporter* error_reporter, tflite::MemoryPlanner* planner, int block_count, int buffers_per_block, unsigned int seed) {
+  constexpr int kStepsPerBlock = 100;
+  for (int block = 0; block < block_count; ++block) {
+    for (int i = 0; i < buffers_per_block; ++i) {
+      const int size = (NextRandom(&seed, 64) + 1) * 1024;
+      const int first_time_used = (block * kStepsPerBlock) + NextRandom(&seed, kStepsPerBlock - 10);
+      planner->AddBuffer(error_reporter, size, first_time_used, first_time_used + NextRandom(&seed, 10));
+    }
+  }
+}
+
+// Times planning a sequential model as one graph, and as segments with the
+// serial runner and thread pools of different sizes.
+void CompareSegmentedPlanning(tflite::ErrorReporter* error_reporter) {
+  constexpr int kBlockCount = 64;
+  constexpr int kBuffersPerBlock = 1000;
+  constexpr int buffer_count = kBlockCount * kBuffersPerBlock;
+  const int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  const int segmented_scratch_buffer_size = tflite::SegmentedMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char* greedy_scratch_buffer = new unsigned char[greedy_scratch_buffer_size];
+  unsigned char* segmented_scratch_buffer = new unsigned char[segmented_scratch_buffer_size];
+
+  tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+  AddSequentialModel(error_reporter, &greedy_planner, kBlockCount, kBuffersPerBlock, 1);
+  const auto greedy_start = std::chrono::steady_clock::now();
+  const int greedy_arena_size = greedy_planner.GetMaximumMemorySize();
+  const auto greedy_end = std::chrono::steady_clock::now();
+  const int greedy_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(greedy_end - greedy_start).count();
+  error_reporter->Report("Sequential model, %d buffers in %d blocks: greedy %d us, arena size %d", buffer_count, kBlockCount, greedy_microseconds, greedy_arena_size);
+
+  // A thread count of zero stands for the default serial runner.
+  const int thread_counts[] = {0, 1, 2, 4, 8};
+  for (int thread_count : thread_counts) {
+    tflite::ThreadTaskRunner thread_task_runner((thread_count > 0) ? thread_count : 1);
+    tflite::TaskRunner* task_runner = (thread_count > 0) ? &thread_task_runner : nullptr;
+    tflite::SegmentedMemoryPlanner planner(segmented_scratch_buffer, segmented_scratch_buffer_size, task_runner);
+    AddSequentialModel(error_reporter, &planner, kBlockCount, kBuffersPerBlock, 1);
+    const auto start = std::chrono::steady_clock::now();
+    const int arena_size = planner.GetMaximumMemorySize();
+    const auto end = std::chrono::steady_clock::now();
+    const int microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    error_reporter->Report("  segmented, %d threads: %d us, %d segments, arena size %d", thread_count, microseconds, planner.GetSegmentCount(), arena_size);
+  }
+  delete[] greedy_scratch_buffer;
+  delete[] segmented_scratch_buffer;
+}
+
+// Like AddSyntheticGraph(), but adds the buffers in order of first use, the
+// way a runtime that only learns sizes during execution would see them.
+void AddSyntheticGraphInOrder(tflite::ErrorReporter* error_reporter, tflite::MemoryPlanner* planner, int buffer_count, unsigned int seed) {
+  for (int i = 0; i < buffer_count; ++i) {
+    const int size = (NextRandom(&seed, 64) + 1) * 1024;
+    const int first_time_used = i / 2;
+    int lifetime = NextRandom(&seed, 4);
+    if (NextRandom(&seed, 20) == 0) {
+      lifetime += NextRandom(&seed, 100);
+    }
+    planner->AddBuffer(error_reporter, size, first_time_used, first_time_used + lifetime);
+  }
+}
+
+// Compares planning buffers one at a time as they arrive against planning
+// them all at once with the greedy planner. The streaming time covers every
+// AddBuffer() call, since that's where its work happens.
+void CompareStreamingPlanning(tflite::ErrorReporter* error_reporter) {
+  const int buffer_counts[] = {1000, 10000, 100000};
+  for (int buffer_count : buffer_counts) {
+    const int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+    const int streaming_scratch_buffer_size = tflite::StreamingMemoryPlanner::GetScratchBufferSize(buffer_count);
+    unsigned char* greedy_scratch_buffer = new unsigned char[greedy_scratch_buffer_size];
+    unsigned char* streaming_scratch_buffer = new unsigned char[streaming_scratch_buffer_size];
+    tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+    AddSyntheticGraphInOrder(error_reporter, &greedy_planner, buffer_count, 1);
+    const auto greedy_start = std::chrono::steady_clock::now();
+    const int greedy_arena_size = greedy_planner.GetMaximumMemorySize();
+    const auto streaming_start = std::chrono::steady_clock::now();
+    tflite::StreamingMemoryPlanner streaming_planner(streaming_scratch_buffer, streaming_scratch_buffer_size);
+    AddSyntheticGraphInOrder(error_reporter, &streaming_planner, buffer_count, 1);
+    const int streaming_arena_size = streaming_planner.GetMaximumMemorySize();
+    const auto end = std::chrono::steady_clock::now();
+    const int greedy_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(streaming_start - greedy_start).count();
+    const int streaming_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - streaming_start).count();
+    error_reporter->Report("In-order graph, %d buffers: streaming %d us (%d ns per buffer), arena size %d, greedy %d us, arena size %d", buffer_count, streaming_microseconds, static_cast<int>((static_cast<int64_t>(streaming_microseconds) * 1000) / buffer_count), streaming_arena_size, greedy_microseconds, greedy_arena_size);
+    delete[] greedy_scratch_buffer;
+    delete[] streaming_scratch_buffer;
+  }
+}
+
+// Times re-planning a graph whose sizes depend on the number of tokens as
+// the count changes, against planning the same sizes from scratch with the
+// greedy planner.
+void CompareSymbolicReevaluation(tflite::ErrorReporter* error_reporter) {
+  constexpr int buffer_count = 100000;
+  const int scratch_buffer_size = tflite::SymbolicMemoryPlanner::GetScratchBufferSize(buffer_count);
+  const int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+  unsigned char* greedy_scratch_buffer = new unsigned char[greedy_scratch_buffer_size];
+  int* first_times_used = new int[buffer_count];
+  int* last_times_used = new int[buffer_count];
+  tflite::SymbolicMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    tflite::SymbolicBufferSize size = {};
+    size.constant = NextRandom(&seed, 256);
+    size.coefficients[0] = (NextRandom(&seed, 64) + 1) * 16;
+    first_times_used[i] = NextRandom(&seed, buffer_count / 2);
+    last_times_used[i] = first_times_used[i] + NextRandom(&seed, 4);
+    planner.AddSymbolicBuffer(error_reporter, size, first_times_used[i], last_times_used[i], 16);
+  }
+  planner.SetDimensionValue(error_reporter, 0, 128);
+  planner.GetMaximumMemorySize();
+
+  const int token_counts[] = {256, 512, 384, 1024, 16};
+  for (int token_count : token_counts) {
+    planner.SetDimensionValue(error_reporter, 0, token_count);
+    const auto start = std::chrono::steady_clock::now();
+    const int arena_size = planner.GetMaximumMemorySize();
+    const auto end = std::chrono::steady_clock::now();
+    const int microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+    for (int i = 0; i < buffer_count; ++i) {
+      int size;
+      planner.GetBufferSize(error_reporter, i, &size);
+      greedy_planner.AddBuffer(error_reporter, size, first_times_used[i], last_times_used[i], 16);
+    }
+    const auto greedy_start = std::chrono::steady_clock::now();
+    const int greedy_arena_size = greedy_planner.GetMaximumMemorySize();
+    const auto greedy_end = std::chrono::steady_clock::now();
+    const int greedy_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(greedy_end - greedy_start).count();
+    error_reporter->Report("Symbolic sizes, %d tokens: %s %d us, arena size %d, greedy %d us, arena size %d", token_count, planner.WasLastPlanReused() ? "re-evaluated" : "full plan", microseconds, arena_size, greedy_microseconds, greedy_arena_size);
+  }
+  delete[] scratch_buffer;
+  delete[] greedy_scratch_buffer;
+  delete[] first_times_used;
+  delete[] last_times_used;
+}
+
+// Times checking a greedy plan with VerifyMemoryPlan(), against comparing
+// every pair of buffers on the smaller graphs.
+void CompareMemoryPlanVerification(tflite::ErrorReporter* error_reporter) {
+  const int buffer_counts[] = {10000, 100000};
+  for (int buffer_count : buffer_counts) {
+    const int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+    unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+    tflite::BufferRequirements* requirements = new tflite::BufferRequirements[buffer_count];
+    int* offsets = new int[buffer_count];
+    int* verify_scratch = new int[tflite::GetVerifyMemoryPlanScratchCount(buffer_count)];
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    unsigned int seed = 1;
+    for (int i = 0; i < buffer_count; ++i) {
+      requirements[i].size = (NextRandom(&seed, 64) + 1) * 1024;
+      requirements[i].first_time_used = NextRandom(&seed, buffer_count / 2);
+      requirements[i].last_time_used = requirements[i].first_time_used + NextRandom(&seed, 4);
+      requirements[i].alignment = 16;
+      planner.AddBuffer(error_reporter, requirements[i].size, requirements[i].first_time_used, requirements[i].last_time_used, requirements[i].alignment);
+    }
+    for (int i = 0; i < buffer_count; ++i) {
+      planner.GetOffsetForBuffer(error_reporter, i, &offsets[i]);
+    }
+    const int arena_size = planner.GetMaximumMemorySize();
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool is_valid = tflite::VerifyMemoryPlan(error_reporter, requirements, offsets, buffer_count, arena_size, verify_scratch);
+    const auto end = std::chrono::steady_clock::now();
+    const int microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (buffer_count > 10000) {
+      error_reporter->Report("Verify plan, %d buffers: %d us, valid %d", buffer_count, microseconds, is_valid);
+    } else {
+      bool is_pairwise_valid = true;
+      const auto pairwise_start = std::chrono::steady_clock::now();
+      for (int i = 0; i < buffer_count; ++i) {
+        for (int j = 0; j < i; ++j) {
+          const bool share_time = (requirements[i].first_time_used <= requirements[j].last_time_used) && (requirements[j].first_time_used <= requirements[i].last_time_used);
+          const bool share_memory = (offsets[i] < (offsets[j] + requirements[j].size)) && (offsets[j] < (offsets[i] + requirements[i].size));
+          if (share_time && share_memory) {
+            is_pairwise_valid = false;
+          }
+        }
+      }
+      const auto pairwise_end = std::chrono::steady_clock::now();
+      const int pairwise_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(pairwise_end - pairwise_start).count();
+      error_reporter->Report("Verify plan, %d buffers: %d us, valid %d, every pair %d us, valid %d", buffer_count, microseconds, is_valid, pairwise_microseconds, is_pairwise_valid);
+    }
+    delete[] scratch_buffer;
+    delete[] requirements;
+    delete[] offsets;
+    delete[] verify_scratch;
+  }
+}
+
+// Arena size from planning a graph with a particular gap selection policy.
+int GreedyArenaSizeForPolicy(tflite::ErrorReporter* error_reporter, int buffer_count, unsigned int seed, tflite::GreedyMemoryPlanner::GapSelectionPolicy policy) {
+  const int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  planner.SetGapSelectionPolicy(policy);
+  AddSyntheticGraph(error_reporter, &planner, buffer_count, seed);
+  const int arena_size = planner.GetMaximumMemorySize();
+  delete[] scratch_buffer;
+  return arena_size;
+}
+
+// Compares the arena sizes each gap selection policy gives over a set of
+// graphs, as a percentage of the first-fit size.
+void CompareGapSelectionPolicies(tflite::ErrorReporter* error_reporter) {
+  constexpr int kGraphCount = 20;
+  int64_t first_fit_total = 0;
+  int64_t best_fit_total = 0;
+  int64_t worst_fit_total = 0;
+  int best_fit_wins = 0;
+  int best_fit_losses = 0;
+  for (int graph = 0; graph < kGraphCount; ++graph) {
+    const int buffer_count = 100 + (graph * 50);
+    const unsigned int seed = graph + 1;
+    const int first_fit = GreedyArenaSizeForPolicy(error_reporter, buffer_count, seed, tflite::GreedyMemoryPlanner::kFirstFit);
+    const int best_fit = GreedyArenaSizeForPolicy(error_reporter, buffer_count, seed, tflite::GreedyMemoryPlanner::kBestFit);
+    const int worst_fit = GreedyArenaSizeForPolicy(error_reporter, buffer_count, seed, tflite::GreedyMemoryPlanner::kWorstFit);
+    first_fit_total += first_fit;
+    best_fit_total += best_fit;
+    worst_fit_total += worst_fit;
+    if (best_fit < first_fit) {
+      ++best_fit_wins;
+    } else if (best_fit > first_fit) {
+      ++best_fit_losses;
+    }
+  }
+  error_reporter->Report("Gap policies over %d graphs, total arena in thousandths of first fit: best fit %d, worst fit %d", kGraphCount, static_cast<int>((best_fit_total * 1000) / first_fit_total), static_cast<int>((worst_fit_total * 1000) / first_fit_total));
+  error_reporter->Report("Best fit was smaller on %d graphs, and larger on %d", best_fit_wins, best_fit_losses);
+}
+
+// Shows how much refinement shrinks the arena for different iteration
+// budgets, and how long it takes, over a set of mid-sized graphs.
+void CompareRefinementBudgets(tflite::ErrorReporter* error_reporter) {
+  constexpr int kGraphCount = 10;
+  constexpr int kBufferCount = 200;
+  const int iteration_counts[] = {0, 100, 1000, 10000, 100000};
+  const int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(kBufferCount);
+  unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+  int64_t unrefined_total = 0;
+  for (int iteration_count : iteration_counts) {
+    int64_t arena_total = 0;
+    int64_t microseconds_total = 0;
+    for (int graph = 0; graph < kGraphCount; ++graph) {
+      tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+      planner.SetRefinementIterations(iteration_count);
+      AddSyntheticGraph(error_reporter, &planner, kBufferCount, graph + 1);
+      const auto start = std::chrono::steady_clock::now();
+      arena_total += planner.GetMaximumMemorySize();
+      const auto end = std::chrono::steady_clock::now();
+      microseconds_total += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+    if (iteration_count == 0) {
+      unrefined_total = arena_total;
+    }
+    error_reporter->Report("Refinement, %d iterations: total arena in thousandths of unrefined %d, %d us per graph", iteration_count, static_cast<int>((arena_total * 1000) / unrefined_total), static_cast<int>(microseconds_total / kGraphCount));
+  }
+  delete[] scratch_buffer;
+}
+
+// Times the vectorized overlap mask against the scalar loop on the 16-entry
+// runs the greedy planner's time index scans.
+void CompareOverlapMaskKernels(tflite::ErrorReporter* error_reporter) {
+  constexpr int kRunCount = 1024;
+  constexpr int kRunLength = 16;
+  constexpr int kPassCount = 1000;
+  int* first_times = new int[kRunCount * kRunLength];
+  int* last_times = new int[kRunCount * kRunLength];
+  unsigned int seed = 1;
+  for (int i = 0; i < (kRunCount * kRunLength); ++i) {
+    first_times[i] = NextRandom(&seed, 1000);
+    last_times[i] = first_times[i] + NextRandom(&seed, 10);
+  }
+  uint32_t (*const kernels[])(const int*, const int*, int, int, int) = {tflite::CalculateTimeOverlapMaskScalar, tflite::CalculateTimeOverlapMask};
+  const char* const kernel_names[] = {"scalar", "vectorized"};
+  // Summing the masks stops the compiler discarding the calls.
+  uint32_t checksums[2] = {0, 0};
+  for (int k = 0; k < 2; ++k) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < kPassCount; ++pass) {
+      for (int run = 0; run < kRunCount; ++run) {
+        const int wanted_first = (pass + run) % 1000;
+        checksums[k] += kernels[k](first_times + (run * kRunLength), last_times + (run * kRunLength), kRunLength, wanted_first, wanted_first + 5);
+      }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    error_reporter->Report("Overlap mask, %s: %d ns per %d runs of %d buffers", kernel_names[k], static_cast<int>(nanoseconds / kPassCount), kRunCount, kRunLength);
+  }
+  if (checksums[0] != checksums[1]) {
+    error_reporter->Report("Overlap mask kernels disagree!");
+  }
+  delete[] first_times;
+  delete[] last_times;
+}
+
+// Compares planning with the interval tree against the time step index, and
+// shows how much memory the index needs, for graphs with different numbers of
+// buffers and time steps.
+void CompareTimeStepIndex(tflite::ErrorReporter* error_reporter) {
+  const int buffer_counts[] = {1000, 10000};
+  const int time_step_counts[] = {200, 2000};
+  for (int buffer_count : buffer_counts) {
+    for (int time_step_count : time_step_counts) {
+      const int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+      unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+      // Long-lived buffers can run past the last step, so leave room for them.
+      const int index_size = tflite::GreedyMemoryPlanner::GetTimeStepIndexSize(buffer_count, time_step_count + 104);
+      unsigned char* index_buffer = new unsigned char[index_size];
+      int microseconds[2] = {0, 0};
+      int arena_sizes[2] = {0, 0};
+      bool was_index_used = false;
+      for (int use_index = 0; use_index < 2; ++use_index) {
+        for (int i = 0; i < kRepeatCount; ++i) {
+          tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+          if (use_index) {
+            planner.SetTimeStepIndex(index_buffer, index_size);
+          }
+          AddSyntheticGraphOverTimeSteps(error_reporter, &planner, buffer_count, time_step_count, 1);
+          const auto start = std::chrono::steady_clock::now();
+          arena_sizes[use_index] = planner.GetMaximumMemorySize();
+          const auto end = std::chrono::steady_clock::now();
+          const int elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+          if ((i == 0) || (elapsed < microseconds[use_index])) {
+            microseconds[use_index] = elapsed;
+          }
+          was_index_used = planner.WasTimeStepIndexUsed();
+        }
+      }
+      error_reporter->Report("Time step index, %d buffers over %d steps: %d KB, %d us against %d us for the tree%s", buffer_count, time_step_count, index_size / 1024, microseconds[1], microseconds[0], (was_index_used && (arena_sizes[0] == arena_sizes[1])) ? "" : " (MISMATCH)");
+      delete[] scratch_buffer;
+      delete[] index_buffer;
+    }
+  }
+}
+
+// An activation buffer in a model built by AddMobileNetOp().
+struct BenchmarkTensor {
+  int size;
+  int first_time_used;
+  int last_time_used;
+  // The input this tensor can be written over, or -1.
+  int alias_input;
+};
+
+// Adds an op to the model that reads one or two tensors and writes a new one
+// of the given size, at the next time step. Returns the new tensor's index.
+int AddMobileNetOp(BenchmarkTensor* tensors, int* tensor_count, int* time_step, int size, int input, int second_input, bool is_elementwise) {
+  ++(*time_step);
+  tensors[input].last_time_used = *time_step;
+  if (second_input != -1) {
+    tensors[second_input].last_time_used = *time_step;
+  }
+  BenchmarkTensor* output = &tensors[*tensor_count];
+  output->size = size;
+  output->first_time_used = *time_step;
+  output->last_time_used = *time_step;
+  output->alias_input = is_elementwise ? input : -1;
+  return (*tensor_count)++;
+}
+
+// Builds the int8 activations of a MobileNet v2 style model, where every
+// convolution is followed by a separate ReLU6 op, and blocks with matching
+// shapes finish with a residual add. Returns how many tensors there are.
+int BuildMobileNetChain(BenchmarkTensor* tensors) {
+  // Expansion factor, output channels, repeats, and first stride, for each
+  // group of inverted residual blocks.
+  const int block_groups[][4] = {
+      {1, 16, 1, 1}, {6, 24, 2, 2}, {6, 32, 3, 2}, {6, 64, 4, 2}, {6, 96, 3, 1}, {6, 160, 3, 2}, {6, 320, 1, 1},
+  };
+  int tensor_count = 0;
+  int time_step = 0;
+  int resolution = 224;
+  int channels = 3;
+  BenchmarkTensor* image = &tensors[tensor_count++];
+  image->size = resolution * resolution * channels;
+  image->first_time_used = 0;
+  image->last_time_used = 0;
+  image->alias_input = -1;
+  int x = 0;
+  resolution /= 2;
+  channels = 32;
+  x = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * channels, x, -1, false);
+  x = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * channels, x, -1, true);
+  for (const auto& group : block_groups) {
+    for (int repeat = 0; repeat < group[2]; ++repeat) {
+      const int stride = (repeat == 0) ? group[3] : 1;
+      const int block_input = x;
+      const int block_input_channels = channels;
+      const int expanded_channels = channels * group[0];
+      int y = x;
+      if (group[0] != 1) {
+        y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * expanded_channels, y, -1, false);
+        y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * expanded_channels, y, -1, true);
+      }
+      resolution /= stride;
+      y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * expanded_channels, y, -1, false);
+      y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * expanded_channels, y, -1, true);
+      channels = group[1];
+      y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * channels, y, -1, false);
+      if ((stride == 1) && (block_input_channels == channels)) {
+        y = AddMobileNetOp(tensors, &tensor_count, &time_step, resolution * resolution * channels, y, block_input, true);
+      }
+      x = y;
+    }
+  }
+  return tensor_count;
+}
+
+// Compares the arena for a MobileNet style model with and without letting
+// element-wise ops write over their inputs.
+void CompareAliasPairs(tflite::ErrorReporter* error_reporter) {
+  constexpr int kMaxTensorCount = 128;
+  BenchmarkTensor tensors[kMaxTensorCount];
+  const int tensor_count = BuildMobileNetChain(tensors);
+  const int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(tensor_count);
+  unsigned char* scratch_buffer = new unsigned char[scratch_buffer_size];
+  for (int use_aliases = 0; use_aliases < 2; ++use_aliases) {
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    for (int i = 0; i < tensor_count; ++i) {
+      planner.AddBuffer(error_reporter, tensors[i].size, tensors[i].first_time_used, tensors[i].last_time_used);
+    }
+    if (use_aliases) {
+      for (int i = 0; i < tensor_count; ++i) {
+        if (tensors[i].alias_input != -1) {
+          planner.AddAliasPair(error_reporter, tensors[i].alias_input, i);
+        }
+      }
+    }
+    error_reporter->Report("MobileNet chain, %d tensors, %s alias pairs: arena size %d, lower bound %d", tensor_count, use_aliases ? "with" : "without", planner.GetMaximumMemorySize(), planner.GetMemoryLowerBound());
+  }
+  delete[] scratch_buffer;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  const int buffer_counts[] = {1000, 10000, 100000};
+  for (int buffer_count : buffer_counts) {
+    int arena_size;
+    const int microseconds = TimePlanning<tflite::GreedyMemoryPlanner>(error_reporter, buffer_count, &arena_size);
+    error_reporter->Report("Greedy, %d buffers: %d us (%d ns per buffer), arena size %d", buffer_count, microseconds, static_cast<int>((static_cast<int64_t>(microseconds) * 1000) / buffer_count), arena_size);
+    int skyline_arena_size;
+    const int skyline_microseconds = TimePlanning<tflite::SkylineMemoryPlanner>(error_reporter, buffer_count, &skyline_arena_size);
+    error_reporter->Report("Skyline, %d buffers: %d us (%d ns per buffer), arena size %d", buffer_count, skyline_microseconds, static_cast<int>((static_cast<int64_t>(skyline_microseconds) * 1000) / buffer_count), skyline_arena_size);
+  }
+  CompareSkylineOnDenseGraphs(error_reporter);
+  CompareSegmentedPlanning(error_reporter);
+  CompareStreamingPlanning(error_reporter);
+  CompareSymbolicReevaluation(error_reporter);
+  CompareMemoryPlanVerification(error_reporter);
+  CompareOverlapMaskKernels(error_reporter);
+  CompareTimeStepIndex(error_reporter);
+  CompareGapSelectionPolicies(error_reporter);
+  CompareRefinementBudgets(error_reporter);
+  CompareAliasPairs(error_reporter);
+  return 0;
+}
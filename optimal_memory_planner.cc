@@ -0,0 +1,284 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "optimal_memory_planner.h"
+
+#include <cstdint>
+
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+
+OptimalMemoryPlanner::OptimalMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size)
+    : greedy_planner_(scratch_buffer, GreedyMemoryPlanner::GetScratchBufferSize(CalculateMaxBufferCount(scratch_buffer_size))),
+      max_buffer_count_(CalculateMaxBufferCount(scratch_buffer_size)),
+      buffer_count_(0),
+      best_arena_size_(0),
+      lower_bound_(0),
+      max_node_count_(1 << 20),
+      current_time_(nullptr),
+      max_duration_(0),
+      search_start_time_(0),
+      node_count_(0),
+      is_search_stopped_(false),
+      is_plan_optimal_(false),
+      need_to_calculate_offsets_(true) {
+  unsigned char* own_scratch = scratch_buffer + GreedyMemoryPlanner::GetScratchBufferSize(max_buffer_count_);
+  const int misalignment = reinterpret_cast<uintptr_t>(own_scratch) % kScratchAlignment;
+  if (misalignment != 0) {
+    own_scratch += kScratchAlignment - misalignment;
+  }
+  int* next_array = reinterpret_cast<int*>(own_scratch);
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_array);
+  next_array += max_buffer_count_ * (sizeof(BufferRequirements) / sizeof(int));
+  int** const arrays[] = {
+      &buffer_ids_in_search_order_,
+      &current_offsets_,
+      &placed_buffer_ids_,
+      &unplaced_sizes_,
+      &best_offsets_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  lower_bound_scratch_ = next_array;
+}
+
+OptimalMemoryPlanner::~OptimalMemoryPlanner() {}
+
+int OptimalMemoryPlanner::CalculateMaxBufferCount(int scratch_buffer_size) {
+  const int fixed_size = GetScratchBufferSize(0);
+  const int per_buffer_size = GetScratchBufferSize(1) - fixed_size;
+  const int max_buffer_count = (scratch_buffer_size - fixed_size) / per_buffer_size;
+  return (max_buffer_count < 0) ? 0 : max_buffer_count;
+}
+
+bool OptimalMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool OptimalMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!greedy_planner_.AddBuffer(error_reporter, size, first_time_used, last_time_used, alignment)) {
+    return false;
+  }
+  BufferRequirements* current = &requirements_[buffer_count_];
+  current->size = size;
+  current->first_time_used = first_time_used;
+  current->last_time_used = last_time_used;
+  current->alignment = alignment;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+void OptimalMemoryPlanner::SetNodeBudget(int64_t max_node_count) {
+  max_node_count_ = max_node_count;
+  need_to_calculate_offsets_ = true;
+}
+
+void OptimalMemoryPlanner::SetTimeBudget(int64_t (*current_time)(), int64_t max_duration) {
+  current_time_ = current_time;
+  max_duration_ = max_duration;
+  need_to_calculate_offsets_ = true;
+}
+
+int OptimalMemoryPlanner::FindLowestOffset(int buffer_id, int placed_count) const {
+  const BufferRequirements* wanted = &requirements_[buffer_id];
+  int offset = 0;
+  for (int i = 0; i < placed_count; ++i) {
+    const int placed_id = placed_buffer_ids_[i];
+    const BufferRequirements* placed = &requirements_[placed_id];
+    if ((placed->first_time_used > wanted->last_time_used) || (wanted->first_time_used > placed->last_time_used)) {
+      continue;
+    }
+    const int placed_end = current_offsets_[placed_id] + placed->size;
+    if (placed_end > offset) {
+      offset = placed_end;
+    }
+  }
+  return AlignOffset(offset, wanted->alignment);
+}
+
+void OptimalMemoryPlanner::UpdateUnplacedSizes(int buffer_id, int delta) {
+  const BufferRequirements* changed = &requirements_[buffer_id];
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int time = requirements_[i].first_time_used;
+    if ((time >= changed->first_time_used) && (time <= changed->last_time_used)) {
+      unplaced_sizes_[i] += delta;
+    }
+  }
+}
+
+int OptimalMemoryPlanner::GetMaxUnplacedSize() const {
+  int max_size = 0;
+  for (int i = 0; i < buffer_count_; ++i) {
+    if (unplaced_sizes_[i] > max_size) {
+      max_size = unplaced_sizes_[i];
+    }
+  }
+  return max_size;
+}
+
+bool OptimalMemoryPlanner::IsOverBudget() {
+  if (node_count_ >= max_node_count_) {
+    return true;
+  }
+  if ((current_time_ != nullptr) && ((node_count_ % kTimeCheckInterval) == 0)) {
+    if ((current_time_() - search_start_time_) >= max_duration_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void OptimalMemoryPlanner::Search(int placed_count, int last_offset, int last_rank, int current_arena_size) {
+  if (IsOverBudget()) {
+    is_search_stopped_ = true;
+    return;
+  }
+  ++node_count_;
+  if (placed_count == buffer_count_) {
+    // Every branch that reaches here has already been checked to be smaller
+    // than the best plan.
+    best_arena_size_ = current_arena_size;
+    for (int i = 0; i < buffer_count_; ++i) {
+      best_offsets_[i] = current_offsets_[i];
+    }
+    return;
+  }
+  for (int rank = 0; rank < buffer_count_; ++rank) {
+    const int buffer_id = buffer_ids_in_search_order_[rank];
+    if (current_offsets_[buffer_id] != -1) {
+      continue;
+    }
+    // Keep offsets in ascending order, and buffers at the same offset in
+    // search order, so each layout is only reached once.
+    const int offset = FindLowestOffset(buffer_id, placed_count);
+    if ((offset < last_offset) || ((offset == last_offset) && (rank < last_rank))) {
+      continue;
+    }
+    int arena_size = offset + requirements_[buffer_id].size;
+    if (arena_size < current_arena_size) {
+      arena_size = current_arena_size;
+    }
+    if (arena_size >= best_arena_size_) {
+      continue;
+    }
+    current_offsets_[buffer_id] = offset;
+    placed_buffer_ids_[placed_count] = buffer_id;
+    UpdateUnplacedSizes(buffer_id, -requirements_[buffer_id].size);
+    // Everything still to be placed has to go at or above this offset.
+    if ((offset + GetMaxUnplacedSize()) < best_arena_size_) {
+      Search(placed_count + 1, offset, rank, arena_size);
+    }
+    UpdateUnplacedSizes(buffer_id, requirements_[buffer_id].size);
+    current_offsets_[buffer_id] = -1;
+    if (is_search_stopped_ || (best_arena_size_ == lower_bound_)) {
+      return;
+    }
+  }
+}
+
+void OptimalMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  node_count_ = 0;
+  is_search_stopped_ = false;
+
+  // Start with the greedy plan, and finish early if it's already as small as
+  // anything can be.
+  best_arena_size_ = greedy_planner_.GetMaximumMemorySize();
+  for (int i = 0; i < buffer_count_; ++i) {
+    greedy_planner_.GetOffsetForBuffer(nullptr, i, &best_offsets_[i]);
+  }
+  lower_bound_ = CalculateMemoryLowerBound(requirements_, buffer_count_, lower_bound_scratch_);
+  if (best_arena_size_ == lower_bound_) {
+    is_plan_optimal_ = true;
+    return;
+  }
+
+  // Try the largest buffers first, since they're most likely to lead to a
+  // good plan quickly, and that lets more branches be pruned.
+  int* sort_keys = lower_bound_scratch_;
+  int* sort_scratch_values = sort_keys + buffer_count_;
+  int* sort_scratch_ids = sort_scratch_values + buffer_count_;
+  for (int i = 0; i < buffer_count_; ++i) {
+    sort_keys[i] = requirements_[i].size;
+    buffer_ids_in_search_order_[i] = i;
+  }
+  ReverseSortWithScratch(sort_keys, buffer_ids_in_search_order_, buffer_count_, sort_scratch_values, sort_scratch_ids);
+  for (int i = 0; i < buffer_count_; ++i) {
+    current_offsets_[i] = -1;
+    unplaced_sizes_[i] = 0;
+  }
+  for (int i = 0; i < buffer_count_; ++i) {
+    UpdateUnplacedSizes(i, requirements_[i].size);
+  }
+
+  if (current_time_ != nullptr) {
+    search_start_time_ = current_time_();
+  }
+  Search(0, 0, 0, 0);
+  is_plan_optimal_ = !is_search_stopped_;
+}
+
+int OptimalMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return best_arena_size_;
+}
+
+int OptimalMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool OptimalMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  CalculateOffsetsIfNeeded();
+  *offset = best_offsets_[buffer_index];
+  return true;
+}
+
+int OptimalMemoryPlanner::GetMemoryLowerBound() {
+  CalculateOffsetsIfNeeded();
+  return lower_bound_;
+}
+
+int OptimalMemoryPlanner::GetOptimalityGap() {
+  return GetMaximumMemorySize() - GetMemoryLowerBound();
+}
+
+float OptimalMemoryPlanner::GetOptimalityRatio() {
+  return CalculateOptimalityRatio(GetMaximumMemorySize(), GetMemoryLowerBound());
+}
+
+bool OptimalMemoryPlanner::IsPlanOptimal() {
+  CalculateOffsetsIfNeeded();
+  return is_plan_optimal_;
+}
+
+int64_t OptimalMemoryPlanner::GetSearchNodeCount() {
+  CalculateOffsetsIfNeeded();
+  return node_count_;
+}
+
+}  // namespace tflite
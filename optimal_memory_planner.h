@@ -0,0 +1,168 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_OPTIMAL_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_OPTIMAL_MEMORY_PLANNER_H_
+
+#include <cstdint>
+
+#include "greedy_memory_planner.h"
+#include "memory_lower_bound.h"
+#include "memory_planner.h"
+
+namespace tflite {
+
+// A memory planner that searches for the smallest possible arena, for small
+// graphs where every byte matters and planning time doesn't.
+//
+// The search works like this:
+//  - The greedy planner's result is used as the best plan to start with.
+//  - If that's as small as the peak total of buffers that are active at the
+//    same time, it can't be beaten and the search is skipped.
+//  - Otherwise buffers are placed one at a time, each directly on top of the
+//    highest buffer already placed that it overlaps in time. Any compacted
+//    layout can be built this way by placing its buffers in order of offset,
+//    so the search tries every order, with larger buffers first.
+//  - Only orders where offsets never decrease are explored, since the others
+//    give layouts that are also reached by an order that does.
+//  - A branch is abandoned once it can't beat the best plan so far. Every
+//    unplaced buffer has to go above the last offset, so the last offset plus
+//    the most unplaced bytes active at any one time is a lower bound.
+//  - The search stops early if the node or time budget runs out, keeping the
+//    best plan found so far.
+//
+// The number of orders grows factorially, so this is only practical for tens
+// of buffers, or for improving a plan as far as a budget allows.
+class OptimalMemoryPlanner : public MemoryPlanner {
+ public:
+  // The scratch buffer has the same requirements as GreedyMemoryPlanner's.
+  OptimalMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
+  virtual ~OptimalMemoryPlanner() override;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including room for alignment.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return GreedyMemoryPlanner::GetScratchBufferSize(max_buffer_count) + (max_buffer_count * kPerBufferScratchSize) + (kScratchAlignment - 1);
+  }
+
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // Stops the search after visiting this many nodes. The default is about a
+  // million, which takes well under a second on a desktop machine.
+  void SetNodeBudget(int64_t max_node_count);
+
+  // Stops the search once current_time() has advanced by max_duration since
+  // the search started. The units are whatever current_time() returns, so on
+  // devices this can be a cycle counter. A null current_time removes the
+  // limit, which is the default.
+  void SetTimeBudget(int64_t (*current_time)(), int64_t max_duration);
+
+  // Whether the search finished, proving that no smaller arena is possible.
+  bool IsPlanOptimal();
+
+  // The peak total size of buffers active at the same time. No plan can use
+  // a smaller arena than this.
+  int GetMemoryLowerBound();
+
+  // How many bytes larger the arena is than GetMemoryLowerBound(), and how
+  // many times larger as a ratio. Unless the plan is optimal,
+  // these show how much further searching could save at most.
+  int GetOptimalityGap();
+  float GetOptimalityRatio();
+
+  // How many nodes the last search visited.
+  int64_t GetSearchNodeCount();
+
+ private:
+  // How many buffers fit in a scratch buffer of the given size.
+  static int CalculateMaxBufferCount(int scratch_buffer_size);
+
+  // Tries every way of placing the remaining buffers, starting from the
+  // current partial plan.
+  void Search(int placed_count, int last_offset, int last_rank, int current_arena_size);
+
+  // The lowest aligned offset a buffer can go at, on top of every buffer
+  // placed so far that's active at the same time.
+  int FindLowestOffset(int buffer_id, int placed_count) const;
+
+  // Adds or removes a buffer's size from the unplaced totals at every
+  // sampled time step it's active.
+  void UpdateUnplacedSizes(int buffer_id, int delta);
+
+  // The largest total size of unplaced buffers active at the same time.
+  int GetMaxUnplacedSize() const;
+
+  // Whether the node or time budget has run out.
+  bool IsOverBudget();
+
+  // If there isn't an up to date plan, calculate a new one.
+  void CalculateOffsetsIfNeeded();
+
+  static constexpr int kScratchAlignment = alignof(int);
+
+  // Requirements, plus five int arrays, plus the lower bound's scratch.
+  static constexpr int kPerBufferScratchSize = sizeof(BufferRequirements) + (5 * sizeof(int)) + (GetMemoryLowerBoundScratchCount(1) * sizeof(int));
+
+  // How often the time budget is checked, in nodes.
+  static constexpr int kTimeCheckInterval = 1024;
+
+  // Used for the starting plan.
+  GreedyMemoryPlanner greedy_planner_;
+
+  BufferRequirements* requirements_;
+  int max_buffer_count_;
+  int buffer_count_;
+
+  // The order the search tries buffers in, largest first.
+  int* buffer_ids_in_search_order_;
+
+  // The partial plan being explored. Placed buffers are listed in the order
+  // they were placed, and a buffer that isn't placed has an offset of -1.
+  int* current_offsets_;
+  int* placed_buffer_ids_;
+
+  // The total size of unplaced buffers active at the time each buffer is
+  // first used. The live total can only peak when a buffer starts, so these
+  // sample every time step that matters.
+  int* unplaced_sizes_;
+
+  // The smallest plan found so far.
+  int* best_offsets_;
+  int best_arena_size_;
+
+  // Scratch for CalculateMemoryLowerBound(), and for sorting.
+  int* lower_bound_scratch_;
+  int lower_bound_;
+
+  // Budget settings, and the state of the current search.
+  int64_t max_node_count_;
+  int64_t (*current_time_)();
+  int64_t max_duration_;
+  int64_t search_start_time_;
+  int64_t node_count_;
+  bool is_search_stopped_;
+  bool is_plan_optimal_;
+
+  // Whether buffers have been added since the last plan was calculated.
+  bool need_to_calculate_offsets_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_OPTIMAL_MEMORY_PLANNER_H_
@@ -0,0 +1,118 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "optimal_memory_planner.h"
+
+#include "memory_lower_bound.h"
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestMemoryLowerBound) {
+  const tflite::BufferRequirements requirements[] = {
+      {10, 0, 1, 1},
+      {20, 1, 2, 1},
+      {30, 2, 3, 1},
+      {40, 3, 4, 1},
+      {50, 0, 1, 1},
+  };
+  int scratch[tflite::GetMemoryLowerBoundScratchCount(5)];
+  TF_LITE_MICRO_EXPECT_EQ(80, tflite::CalculateMemoryLowerBound(requirements, 5, scratch));
+  TF_LITE_MICRO_EXPECT_EQ(0, tflite::CalculateMemoryLowerBound(requirements, 0, scratch));
+}
+
+TF_LITE_MICRO_TEST(TestOptimalBeatsGreedy) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The greedy planner needs 280 bytes for these buffers.
+  constexpr int buffer_count = 6;
+  const int sizes[buffer_count] = {60, 30, 90, 30, 100, 80};
+  const int first_times[buffer_count] = {1, 0, 1, 2, 3, 0};
+  const int last_times[buffer_count] = {1, 2, 3, 2, 3, 1};
+  constexpr int scratch_buffer_size = tflite::OptimalMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::OptimalMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times[i], last_times[i]));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(260, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.IsPlanOptimal());
+
+  // Make sure the plan is valid.
+  for (int i = 0; i < buffer_count; ++i) {
+    int i_offset;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &i_offset));
+    TF_LITE_MICRO_EXPECT_LE(i_offset + sizes[i], 260);
+    for (int j = i + 1; j < buffer_count; ++j) {
+      if ((first_times[i] > last_times[j]) || (first_times[j] > last_times[i])) {
+        continue;
+      }
+      int j_offset;
+      TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, j, &j_offset));
+      TF_LITE_MICRO_EXPECT((i_offset >= (j_offset + sizes[j])) || (j_offset >= (i_offset + sizes[i])));
+    }
+  }
+}
+
+TF_LITE_MICRO_TEST(TestOptimalNodeBudget) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // With no budget to search, the greedy plan is returned.
+  constexpr int scratch_buffer_size = tflite::OptimalMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::OptimalMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  planner.SetNodeBudget(0);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 60, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 0, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 90, 1, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 3, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(280, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.IsPlanOptimal());
+  TF_LITE_MICRO_EXPECT_EQ(260, planner.GetMemoryLowerBound());
+  TF_LITE_MICRO_EXPECT_EQ(20, planner.GetOptimalityGap());
+  TF_LITE_MICRO_EXPECT_EQ(0, static_cast<int>(planner.GetSearchNodeCount()));
+
+  // A plan that matches the lower bound is optimal without any search.
+  tflite::OptimalMemoryPlanner simple_planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, simple_planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, simple_planner.AddBuffer(error_reporter, 20, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(20, simple_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, simple_planner.IsPlanOptimal());
+}
+
+TF_LITE_MICRO_TEST(TestOptimalAlignment) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Greedy puts the larger buffer first and pads up to 16 for the smaller
+  // one, but putting the aligned buffer at zero wastes nothing.
+  constexpr int scratch_buffer_size = tflite::OptimalMemoryPlanner::GetScratchBufferSize(2);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::OptimalMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 5, 1, 2, 16));
+  TF_LITE_MICRO_EXPECT_EQ(15, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.IsPlanOptimal());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+}
+
+TF_LITE_MICRO_TESTS_END
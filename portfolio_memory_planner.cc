@@ -0,0 +1,118 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "portfolio_memory_planner.h"
+
+namespace tflite {
+
+static_assert(GreedyMemoryPlanner::kBufferOrderingCount == 4, "PortfolioMemoryPlanner's constructor needs updating to match the number of orderings");
+
+PortfolioMemoryPlanner::PortfolioMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size, TaskRunner* task_runner)
+    : planners_{
+          {GetPlannerScratchBuffer(scratch_buffer, scratch_buffer_size, 0), scratch_buffer_size / kPlannerCount},
+          {GetPlannerScratchBuffer(scratch_buffer, scratch_buffer_size, 1), scratch_buffer_size / kPlannerCount},
+          {GetPlannerScratchBuffer(scratch_buffer, scratch_buffer_size, 2), scratch_buffer_size / kPlannerCount},
+          {GetPlannerScratchBuffer(scratch_buffer, scratch_buffer_size, 3), scratch_buffer_size / kPlannerCount},
+      },
+      task_runner_(task_runner),
+      chosen_planner_index_(0),
+      chosen_arena_size_(0),
+      need_to_calculate_offsets_(true) {
+  if (task_runner_ == nullptr) {
+    task_runner_ = &serial_task_runner_;
+  }
+  for (int i = 0; i < kPlannerCount; ++i) {
+    planners_[i].SetBufferOrdering(static_cast<GreedyMemoryPlanner::BufferOrdering>(i));
+    arena_sizes_[i] = 0;
+  }
+}
+
+PortfolioMemoryPlanner::~PortfolioMemoryPlanner() {}
+
+unsigned char* PortfolioMemoryPlanner::GetPlannerScratchBuffer(unsigned char* scratch_buffer, int scratch_buffer_size, int planner_index) {
+  return scratch_buffer + ((scratch_buffer_size / kPlannerCount) * planner_index);
+}
+
+bool PortfolioMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool PortfolioMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  // All the planners have the same capacity, so they either all succeed or
+  // the first one reports the error.
+  for (int i = 0; i < kPlannerCount; ++i) {
+    if (!planners_[i].AddBuffer(error_reporter, size, first_time_used, last_time_used, alignment)) {
+      return false;
+    }
+  }
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+void PortfolioMemoryPlanner::CalculatePlan(void* context, int planner_index) {
+  PortfolioMemoryPlanner* portfolio = static_cast<PortfolioMemoryPlanner*>(context);
+  portfolio->arena_sizes_[planner_index] = portfolio->planners_[planner_index].GetMaximumMemorySize();
+}
+
+void PortfolioMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  task_runner_->RunTasks(CalculatePlan, this, kPlannerCount);
+  // Only replace the choice with a strictly smaller arena, so ties always go
+  // to the earliest ordering regardless of which task finished first.
+  chosen_planner_index_ = 0;
+  chosen_arena_size_ = arena_sizes_[0];
+  for (int i = 1; i < kPlannerCount; ++i) {
+    if (arena_sizes_[i] < chosen_arena_size_) {
+      chosen_planner_index_ = i;
+      chosen_arena_size_ = arena_sizes_[i];
+    }
+  }
+}
+
+int PortfolioMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return chosen_arena_size_;
+}
+
+int PortfolioMemoryPlanner::GetBufferCount() { return planners_[0].GetBufferCount(); }
+
+bool PortfolioMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  return planners_[chosen_planner_index_].GetOffsetForBuffer(error_reporter, buffer_index, offset);
+}
+
+int PortfolioMemoryPlanner::GetMemoryLowerBound() {
+  // The bound only depends on the buffers, so any of the planners can give it.
+  CalculateOffsetsIfNeeded();
+  return planners_[chosen_planner_index_].GetMemoryLowerBound();
+}
+
+int PortfolioMemoryPlanner::GetOptimalityGap() {
+  return GetMaximumMemorySize() - GetMemoryLowerBound();
+}
+
+float PortfolioMemoryPlanner::GetOptimalityRatio() {
+  return CalculateOptimalityRatio(GetMaximumMemorySize(), GetMemoryLowerBound());
+}
+
+GreedyMemoryPlanner::BufferOrdering PortfolioMemoryPlanner::GetChosenOrdering() {
+  CalculateOffsetsIfNeeded();
+  return static_cast<GreedyMemoryPlanner::BufferOrdering>(chosen_planner_index_);
+}
+
+}  // namespace tflite
@@ -0,0 +1,103 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_PORTFOLIO_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_PORTFOLIO_MEMORY_PLANNER_H_
+
+#include "greedy_memory_planner.h"
+#include "memory_planner.h"
+#include "task_runner.h"
+
+namespace tflite {
+
+// A memory planner that runs the greedy algorithm once for every buffer
+// ordering it supports, and keeps whichever plan needs the smallest arena.
+// Placing the largest buffers first usually works well, but on some graphs
+// ordering by lifetime, by size multiplied by lifetime, or by first use gives
+// a smaller result.
+//
+// Each ordering gets its own GreedyMemoryPlanner with separate working
+// memory, so they can be planned at the same time by a TaskRunner that uses
+// threads. The choice of plan only depends on the arena sizes, with ties going
+// to the ordering listed first in GreedyMemoryPlanner::BufferOrdering, so the
+// result is the same however the tasks are scheduled.
+class PortfolioMemoryPlanner : public MemoryPlanner {
+ public:
+  // The scratch buffer is split evenly between the greedy planners, and has
+  // the same lifetime requirements as GreedyMemoryPlanner's. If task_runner
+  // is null, the orderings are planned one after another on the calling
+  // thread. Otherwise it must outlive the planner.
+  PortfolioMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size, TaskRunner* task_runner = nullptr);
+  virtual ~PortfolioMemoryPlanner() override;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return kPlannerCount * GreedyMemoryPlanner::GetScratchBufferSize(max_buffer_count);
+  }
+
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // The peak total size of buffers active at the same time. No plan can use
+  // a smaller arena than this.
+  int GetMemoryLowerBound();
+
+  // How many bytes larger the arena is than GetMemoryLowerBound(), and how
+  // many times larger as a ratio. These show how much a more expensive
+  // planner could save at most.
+  int GetOptimalityGap();
+  float GetOptimalityRatio();
+
+  // Which buffer ordering gave the plan that was chosen.
+  GreedyMemoryPlanner::BufferOrdering GetChosenOrdering();
+
+ private:
+  static constexpr int kPlannerCount = GreedyMemoryPlanner::kBufferOrderingCount;
+
+  // Where the scratch memory for a particular planner starts.
+  static unsigned char* GetPlannerScratchBuffer(unsigned char* scratch_buffer, int scratch_buffer_size, int planner_index);
+
+  // Task function that calculates the plan for one of the orderings.
+  static void CalculatePlan(void* context, int planner_index);
+
+  // If there isn't an up to date plan, run all the planners and pick the best.
+  void CalculateOffsetsIfNeeded();
+
+  // One greedy planner for each buffer ordering, in the same order as the
+  // BufferOrdering values.
+  GreedyMemoryPlanner planners_[kPlannerCount];
+
+  // Used if the client didn't supply a task runner.
+  SerialTaskRunner serial_task_runner_;
+  TaskRunner* task_runner_;
+
+  // The planner whose results are returned, and its arena size.
+  int chosen_planner_index_;
+  int chosen_arena_size_;
+
+  // The arena size each planner found, written by CalculatePlan().
+  int arena_sizes_[kPlannerCount];
+
+  // Whether buffers have been added since the last plan was calculated.
+  bool need_to_calculate_offsets_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_PORTFOLIO_MEMORY_PLANNER_H_
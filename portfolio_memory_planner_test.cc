@@ -0,0 +1,83 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "portfolio_memory_planner.h"
+#include "thread_task_runner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestPortfolioPicksSmallestPlan) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Placing by size needs 280 bytes for these buffers, but ordering them by
+  // lifetime only needs 260.
+  constexpr int scratch_buffer_size = tflite::PortfolioMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::PortfolioMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 60, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 0, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 90, 1, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 3, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(6, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(260, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(tflite::GreedyMemoryPlanner::kLifetimeDescending, planner.GetChosenOrdering());
+  TF_LITE_MICRO_EXPECT_EQ(260, planner.GetMemoryLowerBound());
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetOptimalityGap());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 4, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(120, offset);
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 6, &offset));
+}
+
+TF_LITE_MICRO_TEST(TestPortfolioThreadedMatchesSerial) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 500;
+  constexpr int scratch_buffer_size = tflite::PortfolioMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char serial_scratch_buffer[scratch_buffer_size];
+  static unsigned char threaded_scratch_buffer[scratch_buffer_size];
+  tflite::ThreadTaskRunner task_runner(4);
+  tflite::PortfolioMemoryPlanner serial_planner(serial_scratch_buffer, scratch_buffer_size);
+  tflite::PortfolioMemoryPlanner threaded_planner(threaded_scratch_buffer, scratch_buffer_size, &task_runner);
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    const int size = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    const int first_time_used = (seed >> 16) % 200;
+    seed = (seed * 1103515245) + 12345;
+    const int last_time_used = first_time_used + ((seed >> 16) % 20);
+    TF_LITE_MICRO_EXPECT_EQ(true, serial_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used));
+    TF_LITE_MICRO_EXPECT_EQ(true, threaded_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(serial_planner.GetMaximumMemorySize(), threaded_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(serial_planner.GetChosenOrdering(), threaded_planner.GetChosenOrdering());
+  for (int i = 0; i < buffer_count; ++i) {
+    int serial_offset = -1;
+    int threaded_offset = -2;
+    serial_planner.GetOffsetForBuffer(error_reporter, i, &serial_offset);
+    threaded_planner.GetOffsetForBuffer(error_reporter, i, &threaded_offset);
+    TF_LITE_MICRO_EXPECT_EQ(serial_offset, threaded_offset);
+  }
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -16,6 +16,115 @@ limitations under the License.
 #include "reverse_sort_in_place.h"
 
 namespace tflite {
+namespace {
+
+// Runs shorter than this are sorted with an insertion sort before merging,
+// since that's faster than merging for small arrays.
+constexpr int kInsertionSortRunLength = 16;
+
+// Whether a value should be moved in front of an earlier one. Using a strict
+// comparison means equal values are never reordered, so sorts are stable.
+template <bool kDescending>
+inline bool ShouldComeBefore(int value, int earlier_value) {
+  return kDescending ? (value > earlier_value) : (value < earlier_value);
+}
+
+// Stable insertion sort of a short run.
+template <bool kDescending>
+void InsertionSort(int* values, int* ids, int size) {
+  for (int i = 1; i < size; ++i) {
+    const int value = values[i];
+    const int id = ids[i];
+    int j = i;
+    while ((j > 0) && ShouldComeBefore<kDescending>(value, values[j - 1])) {
+      values[j] = values[j - 1];
+      ids[j] = ids[j - 1];
+      --j;
+    }
+    values[j] = value;
+    ids[j] = id;
+  }
+}
+
+// Merges two adjacent sorted runs from the source arrays into the destination
+// arrays. When values are equal the entry from the left run is taken first,
+// which keeps the sort stable.
+template <bool kDescending>
+void MergeRuns(const int* source_values, const int* source_ids, int start, int middle, int end, int* dest_values, int* dest_ids) {
+  int left = start;
+  int right = middle;
+  int output = start;
+  while ((left < middle) && (right < end)) {
+    if (!ShouldComeBefore<kDescending>(source_values[right], source_values[left])) {
+      dest_values[output] = source_values[left];
+      dest_ids[output] = source_ids[left];
+      ++left;
+    } else {
+      dest_values[output] = source_values[right];
+      dest_ids[output] = source_ids[right];
+      ++right;
+    }
+    ++output;
+  }
+  while (left < middle) {
+    dest_values[output] = source_values[left];
+    dest_ids[output] = source_ids[left];
+    ++left;
+    ++output;
+  }
+  while (right < end) {
+    dest_values[output] = source_values[right];
+    dest_ids[output] = source_ids[right];
+    ++right;
+    ++output;
+  }
+}
+
+// Bottom-up merge sort shared by the ascending and descending versions.
+template <bool kDescending>
+void SortWithScratchImpl(int* values, int* ids, int size, int* scratch_values, int* scratch_ids) {
+  for (int start = 0; start < size; start += kInsertionSortRunLength) {
+    int run_length = size - start;
+    if (run_length > kInsertionSortRunLength) {
+      run_length = kInsertionSortRunLength;
+    }
+    InsertionSort<kDescending>(&values[start], &ids[start], run_length);
+  }
+  // Repeatedly merge pairs of runs, ping-ponging between the caller's arrays
+  // and the scratch arrays so that each pass is a single linear copy.
+  int* source_values = values;
+  int* source_ids = ids;
+  int* dest_values = scratch_values;
+  int* dest_ids = scratch_ids;
+  for (int width = kInsertionSortRunLength; width < size; width *= 2) {
+    for (int start = 0; start < size; start += (width * 2)) {
+      int middle = start + width;
+      if (middle > size) {
+        middle = size;
+      }
+      int end = middle + width;
+      if (end > size) {
+        end = size;
+      }
+      MergeRuns<kDescending>(source_values, source_ids, start, middle, end, dest_values, dest_ids);
+    }
+    int* temp_values = source_values;
+    int* temp_ids = source_ids;
+    source_values = dest_values;
+    source_ids = dest_ids;
+    dest_values = temp_values;
+    dest_ids = temp_ids;
+  }
+  // If the last pass left the results in the scratch arrays, copy them back.
+  if (source_values != values) {
+    for (int i = 0; i < size; ++i) {
+      values[i] = source_values[i];
+      ids[i] = source_ids[i];
+    }
+  }
+}
+
+}  // namespace
 
 void ReverseSortInPlace(int* values, int* ids, int size) {
   bool any_swapped;
@@ -35,4 +144,12 @@ void ReverseSortInPlace(int* values, int* ids, int size) {
   } while (any_swapped);
 }
 
+void ReverseSortWithScratch(int* values, int* ids, int size, int* scratch_values, int* scratch_ids) {
+  SortWithScratchImpl<true>(values, ids, size, scratch_values, scratch_ids);
+}
+
+void SortWithScratch(int* values, int* ids, int size, int* scratch_values, int* scratch_ids) {
+  SortWithScratchImpl<false>(values, ids, size, scratch_values, scratch_ids);
+}
+
 }  // namespace tflite
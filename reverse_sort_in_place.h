@@ -21,6 +21,16 @@ namespace tflite {
 // Simple stable in-place sort function. Not time-efficient for large arrays.
 void ReverseSortInPlace(int* values, int* ids, int size);
 
+// Stable sort of values into descending order, with the ids array rearranged
+// to match. Ties keep their original relative order, so this gives exactly the
+// same result as ReverseSortInPlace(). It's a bottom-up merge sort that runs in
+// O(n log n) time, and needs two caller-supplied scratch arrays that can each
+// hold at least size entries.
+void ReverseSortWithScratch(int* values, int* ids, int size, int* scratch_values, int* scratch_ids);
+
+// The same as ReverseSortWithScratch(), but sorts into ascending order.
+void SortWithScratch(int* values, int* ids, int size, int* scratch_values, int* scratch_ids);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_REVERSE_SORT_IN_PLACE_H_
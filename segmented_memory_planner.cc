@@ -0,0 +1,194 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "segmented_memory_planner.h"
+
+#include <cstdint>
+
+#include "micro_error_reporter.h"
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+
+SegmentedMemoryPlanner::SegmentedMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size, TaskRunner* task_runner)
+    : buffer_count_(0),
+      segment_count_(0),
+      arena_size_(0),
+      need_to_calculate_offsets_(true),
+      buffer_ordering_(GreedyMemoryPlanner::kSizeDescending),
+      gap_selection_policy_(GreedyMemoryPlanner::kFirstFit),
+      task_runner_(task_runner) {
+  if (task_runner_ == nullptr) {
+    task_runner_ = &serial_task_runner_;
+  }
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / (kPerBufferScratchSize + kGreedyScratchPerBuffer);
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_array);
+  next_array += max_buffer_count_ * kIntsPerRequirements;
+  int** const arrays[] = {
+      &buffer_offsets_, &first_times_sorted_, &buffer_ids_sorted_by_first_time_, &sort_scratch_values_, &sort_scratch_ids_, &buffer_ids_by_segment_, &segment_ends_, &segment_arena_sizes_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  greedy_scratch_buffer_ = reinterpret_cast<unsigned char*>(next_array);
+}
+
+SegmentedMemoryPlanner::~SegmentedMemoryPlanner() {}
+
+void SegmentedMemoryPlanner::SetBufferOrdering(GreedyMemoryPlanner::BufferOrdering ordering) {
+  buffer_ordering_ = ordering;
+  need_to_calculate_offsets_ = true;
+}
+
+void SegmentedMemoryPlanner::SetGapSelectionPolicy(GreedyMemoryPlanner::GapSelectionPolicy policy) {
+  gap_selection_policy_ = policy;
+  need_to_calculate_offsets_ = true;
+}
+
+bool SegmentedMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool SegmentedMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  BufferRequirements* current = &requirements_[buffer_count_];
+  current->size = size;
+  current->first_time_used = first_time_used;
+  current->last_time_used = last_time_used;
+  current->alignment = alignment;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+void SegmentedMemoryPlanner::FindSegments() {
+  for (int i = 0; i < buffer_count_; ++i) {
+    first_times_sorted_[i] = requirements_[i].first_time_used;
+    buffer_ids_sorted_by_first_time_[i] = i;
+  }
+  SortWithScratch(first_times_sorted_, buffer_ids_sorted_by_first_time_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+
+  // Walking through the buffers in order of first use, a new segment starts
+  // whenever a buffer begins after everything before it has finished.
+  int* const segment_of_buffer = sort_scratch_values_;
+  segment_count_ = 0;
+  int latest_last_time_used = 0;
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_sorted_by_first_time_[i];
+    if ((i > 0) && (first_times_sorted_[i] > latest_last_time_used)) {
+      segment_ends_[segment_count_] = i;
+      ++segment_count_;
+    }
+    segment_of_buffer[buffer_id] = segment_count_;
+    if ((i == 0) || (requirements_[buffer_id].last_time_used > latest_last_time_used)) {
+      latest_last_time_used = requirements_[buffer_id].last_time_used;
+    }
+  }
+  if (buffer_count_ > 0) {
+    segment_ends_[segment_count_] = buffer_count_;
+    ++segment_count_;
+  }
+
+  // Group the ids by segment, keeping the order they were added in, since
+  // that's how the greedy planner breaks ties.
+  int* const next_positions = sort_scratch_ids_;
+  for (int segment = 0; segment < segment_count_; ++segment) {
+    next_positions[segment] = (segment == 0) ? 0 : segment_ends_[segment - 1];
+  }
+  for (int buffer_id = 0; buffer_id < buffer_count_; ++buffer_id) {
+    const int segment = segment_of_buffer[buffer_id];
+    buffer_ids_by_segment_[next_positions[segment]] = buffer_id;
+    ++next_positions[segment];
+  }
+}
+
+void SegmentedMemoryPlanner::PlanSegmentTask(void* context, int segment_index) {
+  static_cast<SegmentedMemoryPlanner*>(context)->PlanSegment(segment_index);
+}
+
+void SegmentedMemoryPlanner::PlanSegment(int segment_index) {
+  // The greedy planner can't run out of room or see a bad alignment, since
+  // both were checked when the buffers were added, so nothing is reported.
+  MicroErrorReporter error_reporter;
+  const int start = (segment_index == 0) ? 0 : segment_ends_[segment_index - 1];
+  const int end = segment_ends_[segment_index];
+  GreedyMemoryPlanner planner(greedy_scratch_buffer_ + (start * kGreedyScratchPerBuffer), (end - start) * kGreedyScratchPerBuffer);
+  planner.SetBufferOrdering(buffer_ordering_);
+  planner.SetGapSelectionPolicy(gap_selection_policy_);
+  for (int i = start; i < end; ++i) {
+    const BufferRequirements* requirements = &requirements_[buffer_ids_by_segment_[i]];
+    planner.AddBuffer(&error_reporter, requirements->size, requirements->first_time_used, requirements->last_time_used, requirements->alignment);
+  }
+  for (int i = start; i < end; ++i) {
+    planner.GetOffsetForBuffer(&error_reporter, i - start, &buffer_offsets_[buffer_ids_by_segment_[i]]);
+  }
+  segment_arena_sizes_[segment_index] = planner.GetMaximumMemorySize();
+}
+
+void SegmentedMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  FindSegments();
+  task_runner_->RunTasks(PlanSegmentTask, this, segment_count_);
+  arena_size_ = 0;
+  for (int segment = 0; segment < segment_count_; ++segment) {
+    if (segment_arena_sizes_[segment] > arena_size_) {
+      arena_size_ = segment_arena_sizes_[segment];
+    }
+  }
+}
+
+int SegmentedMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return arena_size_;
+}
+
+int SegmentedMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool SegmentedMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+int SegmentedMemoryPlanner::GetSegmentCount() {
+  CalculateOffsetsIfNeeded();
+  return segment_count_;
+}
+
+}  // namespace tflite
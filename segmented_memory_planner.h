@@ -0,0 +1,124 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SEGMENTED_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SEGMENTED_MEMORY_PLANNER_H_
+
+#include "greedy_memory_planner.h"
+#include "memory_planner.h"
+#include "task_runner.h"
+
+namespace tflite {
+
+// A memory planner that splits the graph at time steps no buffer is in use
+// across, such as between the blocks of a long sequential model, and plans
+// each segment separately with the greedy algorithm. Buffers in different
+// segments are never in use at the same time, so every segment can start at
+// offset zero and the arena is the largest segment's. The segments are
+// planned as separate tasks, so a TaskRunner with threads can spread them
+// across cores.
+//
+// The greedy placement order is stable and buffers in different segments
+// never affect each other's positions, so the offsets are exactly the ones a
+// single GreedyMemoryPlanner with the same settings would give, however the
+// tasks are scheduled.
+class SegmentedMemoryPlanner : public MemoryPlanner {
+ public:
+  // The scratch buffer has the same lifetime requirements as
+  // GreedyMemoryPlanner's. If task_runner is null, the segments are planned
+  // one after another on the calling thread. Otherwise it must outlive the
+  // planner.
+  SegmentedMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size, TaskRunner* task_runner = nullptr);
+  virtual ~SegmentedMemoryPlanner() override;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including the greedy planners' working memory.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * (kPerBufferScratchSize + kGreedyScratchPerBuffer)) + (kScratchAlignment - 1);
+  }
+
+  // These are passed on to the greedy planner for each segment.
+  void SetBufferOrdering(GreedyMemoryPlanner::BufferOrdering ordering);
+  void SetGapSelectionPolicy(GreedyMemoryPlanner::GapSelectionPolicy policy);
+
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // How many independent segments the current buffers split into.
+  int GetSegmentCount();
+
+ private:
+  // Task function that plans one segment.
+  static void PlanSegmentTask(void* context, int segment_index);
+  void PlanSegment(int segment_index);
+
+  // Finds the segments, and groups the buffer ids by segment.
+  void FindSegments();
+
+  // If there isn't an up to date plan, plan all the segments.
+  void CalculateOffsetsIfNeeded();
+
+  static constexpr int kScratchAlignment = alignof(int);
+  static constexpr int kIntsPerRequirements = sizeof(BufferRequirements) / sizeof(int);
+  static constexpr int kPerBufferScratchSize = sizeof(BufferRequirements) + (8 * sizeof(int));
+
+  // A segment with N buffers gets N times this much greedy scratch memory,
+  // which always covers GreedyMemoryPlanner::GetScratchBufferSize(N), and
+  // means a segment's memory can be found from its first position alone.
+  static constexpr int kGreedyScratchPerBuffer = GreedyMemoryPlanner::GetScratchBufferSize(1);
+
+  int max_buffer_count_;
+  int buffer_count_;
+  int segment_count_;
+  int arena_size_;
+  bool need_to_calculate_offsets_;
+  GreedyMemoryPlanner::BufferOrdering buffer_ordering_;
+  GreedyMemoryPlanner::GapSelectionPolicy gap_selection_policy_;
+
+  // Used if the client didn't supply a task runner.
+  SerialTaskRunner serial_task_runner_;
+  TaskRunner* task_runner_;
+
+  // The client-provided information about each buffer, and its offset.
+  BufferRequirements* requirements_;
+  int* buffer_offsets_;
+
+  // The buffers sorted by first use, used to find the segments.
+  int* first_times_sorted_;
+  int* buffer_ids_sorted_by_first_time_;
+
+  // Working memory for the sort, which is then reused to hold each buffer's
+  // segment and the next free position in each segment while grouping.
+  int* sort_scratch_values_;
+  int* sort_scratch_ids_;
+
+  // The buffer ids grouped by segment, in the order they were added within
+  // each one, and the position after the last buffer of each segment.
+  int* buffer_ids_by_segment_;
+  int* segment_ends_;
+
+  // The arena size each segment needs, written by PlanSegment().
+  int* segment_arena_sizes_;
+
+  // Where the greedy planners' memory starts.
+  unsigned char* greedy_scratch_buffer_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SEGMENTED_MEMORY_PLANNER_H_
@@ -0,0 +1,119 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "segmented_memory_planner.h"
+#include "thread_task_runner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestSegmentedSplitsAtCutPoints) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::SegmentedMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SegmentedMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetSegmentCount());
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetMaximumMemorySize());
+
+  // Steps 0 to 2, 3 to 4, and 5 are independent, with the last segment added
+  // before the others to check the grouping doesn't depend on the order.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 70, 5, 5));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 3, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 4, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 5, 2, 2));
+  TF_LITE_MICRO_EXPECT_EQ(6, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(3, planner.GetSegmentCount());
+  TF_LITE_MICRO_EXPECT_EQ(70, planner.GetMaximumMemorySize());
+
+  const int expected_offsets[] = {0, 20, 0, 40, 0, 20};
+  for (int i = 0; i < 6; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 6, &offset));
+
+  // A buffer spanning the cut points joins everything into one segment.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 8, 2, 5));
+  TF_LITE_MICRO_EXPECT_EQ(1, planner.GetSegmentCount());
+}
+
+TF_LITE_MICRO_TEST(TestSegmentedMatchesGreedy) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Blocks of 40 steps, with buffers that never cross a block boundary.
+  constexpr int buffer_count = 500;
+  constexpr int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  constexpr int scratch_buffer_size = tflite::SegmentedMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char greedy_scratch_buffer[greedy_scratch_buffer_size];
+  static unsigned char serial_scratch_buffer[scratch_buffer_size];
+  static unsigned char threaded_scratch_buffer[scratch_buffer_size];
+  tflite::ThreadTaskRunner task_runner(4);
+  tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+  tflite::SegmentedMemoryPlanner serial_planner(serial_scratch_buffer, scratch_buffer_size);
+  tflite::SegmentedMemoryPlanner threaded_planner(threaded_scratch_buffer, scratch_buffer_size, &task_runner);
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    const int size = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    const int block_start = ((seed >> 16) % 10) * 40;
+    seed = (seed * 1103515245) + 12345;
+    const int first_time_used = block_start + ((seed >> 16) % 30);
+    seed = (seed * 1103515245) + 12345;
+    const int last_time_used = first_time_used + ((seed >> 16) % 10);
+    TF_LITE_MICRO_EXPECT_EQ(true, greedy_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used));
+    TF_LITE_MICRO_EXPECT_EQ(true, serial_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used));
+    TF_LITE_MICRO_EXPECT_EQ(true, threaded_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, serial_planner.GetSegmentCount() >= 10);
+  TF_LITE_MICRO_EXPECT_EQ(serial_planner.GetSegmentCount(), threaded_planner.GetSegmentCount());
+  TF_LITE_MICRO_EXPECT_EQ(greedy_planner.GetMaximumMemorySize(), serial_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(greedy_planner.GetMaximumMemorySize(), threaded_planner.GetMaximumMemorySize());
+  for (int i = 0; i < buffer_count; ++i) {
+    int greedy_offset = -1;
+    int serial_offset = -2;
+    int threaded_offset = -3;
+    greedy_planner.GetOffsetForBuffer(error_reporter, i, &greedy_offset);
+    serial_planner.GetOffsetForBuffer(error_reporter, i, &serial_offset);
+    threaded_planner.GetOffsetForBuffer(error_reporter, i, &threaded_offset);
+    TF_LITE_MICRO_EXPECT_EQ(greedy_offset, serial_offset);
+    TF_LITE_MICRO_EXPECT_EQ(greedy_offset, threaded_offset);
+  }
+}
+
+TF_LITE_MICRO_TEST(TestSegmentedReportsFullScratch) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::SegmentedMemoryPlanner::GetScratchBufferSize(2);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SegmentedMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 2, 2));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 2, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(2, planner.GetSegmentCount());
+  TF_LITE_MICRO_EXPECT_EQ(10, planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TESTS_END
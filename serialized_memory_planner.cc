@@ -0,0 +1,59 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "serialized_memory_planner.h"
+
+namespace tflite {
+
+SerializedMemoryPlanner::SerializedMemoryPlanner() {}
+
+SerializedMemoryPlanner::~SerializedMemoryPlanner() {}
+
+bool SerializedMemoryPlanner::Initialize(ErrorReporter* error_reporter, const unsigned char* data, int data_size) {
+  return reader_.Initialize(error_reporter, data, data_size);
+}
+
+bool SerializedMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool SerializedMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int /*size*/, int /*first_time_used*/, int /*last_time_used*/, int /*alignment*/) {
+  error_reporter->Report("Buffers can't be added to a serialized plan");
+  return false;
+}
+
+int SerializedMemoryPlanner::GetMaximumMemorySize() { return reader_.GetArenaSize(); }
+
+int SerializedMemoryPlanner::GetBufferCount() { return reader_.GetBufferCount(); }
+
+bool SerializedMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  if ((buffer_index < 0) || (buffer_index >= reader_.GetBufferCount())) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, reader_.GetBufferCount());
+    return false;
+  }
+  *offset = reader_.GetOffset(buffer_index);
+  return true;
+}
+
+bool SerializedMemoryPlanner::GetBufferRequirements(tflite::ErrorReporter* error_reporter, int buffer_index, BufferRequirements* requirements) {
+  if ((buffer_index < 0) || (buffer_index >= reader_.GetBufferCount())) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, reader_.GetBufferCount());
+    return false;
+  }
+  reader_.GetRequirements(buffer_index, requirements);
+  return true;
+}
+
+}  // namespace tflite
@@ -0,0 +1,54 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SERIALIZED_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SERIALIZED_MEMORY_PLANNER_H_
+
+#include "memory_plan_serialization.h"
+#include "memory_planner.h"
+
+namespace tflite {
+
+// Answers the planner queries from a plan written by MemoryPlanWriter, for
+// example one that's been mapped into memory from a file. The offsets are
+// read from the data in place, so there's no scratch buffer and nothing is
+// planned at runtime. Buffers can't be added, since the plan is fixed.
+class SerializedMemoryPlanner : public MemoryPlanner {
+ public:
+  SerializedMemoryPlanner();
+  virtual ~SerializedMemoryPlanner() override;
+
+  // Checks the plan and starts using it. The data must stay valid while the
+  // planner is used. Until this succeeds the planner holds no buffers.
+  bool Initialize(ErrorReporter* error_reporter, const unsigned char* data, int data_size);
+
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // The requirements the plan was made for, so callers can check it matches
+  // the buffers they're about to use it for.
+  bool GetBufferRequirements(tflite::ErrorReporter* error_reporter, int buffer_index, BufferRequirements* requirements);
+
+ private:
+  MemoryPlanReader reader_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SERIALIZED_MEMORY_PLANNER_H_
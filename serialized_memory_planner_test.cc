@@ -0,0 +1,116 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "greedy_memory_planner.h"
+#include "serialized_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestSerializedPlanRoundTrip) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 4;
+  const tflite::BufferRequirements requirements[buffer_count] = {
+      {10, 0, 1, 1}, {20, 1, 2, 8}, {30, 2, 3, 1}, {40, 0, 3, 4},
+  };
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    const tflite::BufferRequirements* current = &requirements[i];
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, current->size, current->first_time_used, current->last_time_used, current->alignment));
+  }
+
+  constexpr int serialized_size = tflite::MemoryPlanWriter::GetSerializedSize(buffer_count);
+  TF_LITE_MICRO_EXPECT_EQ(24 + (buffer_count * 20), serialized_size);
+  unsigned char serialized[serialized_size];
+  tflite::MemoryPlanWriter small_writer(serialized, serialized_size - 1);
+  TF_LITE_MICRO_EXPECT_EQ(false, small_writer.Write(error_reporter, &planner, requirements, buffer_count));
+  TF_LITE_MICRO_EXPECT_EQ(false, small_writer.Write(error_reporter, &planner, requirements, buffer_count - 1));
+  tflite::MemoryPlanWriter writer(serialized, serialized_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, writer.Write(error_reporter, &planner, requirements, buffer_count));
+  TF_LITE_MICRO_EXPECT_EQ(serialized_size, writer.GetWrittenSize());
+
+  // The layout is fixed, so check the header bytes don't depend on the host.
+  TF_LITE_MICRO_EXPECT_EQ('T', serialized[0]);
+  TF_LITE_MICRO_EXPECT_EQ('F', serialized[1]);
+  TF_LITE_MICRO_EXPECT_EQ('P', serialized[2]);
+  TF_LITE_MICRO_EXPECT_EQ('L', serialized[3]);
+  TF_LITE_MICRO_EXPECT_EQ(1, serialized[4]);
+  TF_LITE_MICRO_EXPECT_EQ(buffer_count, serialized[8]);
+  TF_LITE_MICRO_EXPECT_EQ(0, serialized[9]);
+
+  tflite::SerializedMemoryPlanner loaded;
+  TF_LITE_MICRO_EXPECT_EQ(0, loaded.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(true, loaded.Initialize(error_reporter, serialized, serialized_size));
+  TF_LITE_MICRO_EXPECT_EQ(buffer_count, loaded.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(planner.GetMaximumMemorySize(), loaded.GetMaximumMemorySize());
+  for (int i = 0; i < buffer_count; ++i) {
+    int expected_offset = -1;
+    int offset = -2;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &expected_offset));
+    TF_LITE_MICRO_EXPECT_EQ(true, loaded.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offset, offset);
+    tflite::BufferRequirements loaded_requirements;
+    TF_LITE_MICRO_EXPECT_EQ(true, loaded.GetBufferRequirements(error_reporter, i, &loaded_requirements));
+    TF_LITE_MICRO_EXPECT_EQ(requirements[i].size, loaded_requirements.size);
+    TF_LITE_MICRO_EXPECT_EQ(requirements[i].first_time_used, loaded_requirements.first_time_used);
+    TF_LITE_MICRO_EXPECT_EQ(requirements[i].last_time_used, loaded_requirements.last_time_used);
+    TF_LITE_MICRO_EXPECT_EQ(requirements[i].alignment, loaded_requirements.alignment);
+  }
+  int offset;
+  TF_LITE_MICRO_EXPECT_EQ(false, loaded.GetOffsetForBuffer(error_reporter, buffer_count, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(false, loaded.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(buffer_count, loaded.GetBufferCount());
+}
+
+TF_LITE_MICRO_TEST(TestSerializedPlanValidation) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 2;
+  const tflite::BufferRequirements requirements[buffer_count] = {
+      {10, 0, 1, 1}, {20, 1, 2, 1},
+  };
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, requirements[i].size, requirements[i].first_time_used, requirements[i].last_time_used));
+  }
+  constexpr int serialized_size = tflite::MemoryPlanWriter::GetSerializedSize(buffer_count);
+  unsigned char serialized[serialized_size];
+  tflite::MemoryPlanWriter writer(serialized, serialized_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, writer.Write(error_reporter, &planner, requirements, buffer_count));
+
+  tflite::MemoryPlanReader reader;
+  TF_LITE_MICRO_EXPECT_EQ(true, reader.Initialize(error_reporter, serialized, serialized_size));
+  TF_LITE_MICRO_EXPECT_EQ(false, reader.Initialize(error_reporter, serialized, serialized_size - 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, reader.Initialize(error_reporter, serialized, 8));
+  TF_LITE_MICRO_EXPECT_EQ(0, reader.GetBufferCount());
+
+  // Any changed byte outside the checksum itself should be caught.
+  for (int i = 0; i < serialized_size; ++i) {
+    serialized[i] ^= 0x40;
+    TF_LITE_MICRO_EXPECT_EQ(false, reader.Initialize(error_reporter, serialized, serialized_size));
+    serialized[i] ^= 0x40;
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, reader.Initialize(error_reporter, serialized, serialized_size));
+}
+
+TF_LITE_MICRO_TESTS_END
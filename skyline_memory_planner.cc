@@ -0,0 +1,231 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "skyline_memory_planner.h"
+
+#include <cstdint>
+
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+namespace {
+
+// The first position in a sorted array with a value of at least time, or
+// count if there isn't one.
+int FindFirstPositionAtOrAfter(const int* sorted_times, int count, int time) {
+  int start = 0;
+  int end = count;
+  while (start < end) {
+    const int middle = start + ((end - start) / 2);
+    if (sorted_times[middle] < time) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+// The first position in a sorted array with a value greater than time, or
+// count if there isn't one.
+int FindFirstPositionAfter(const int* sorted_times, int count, int time) {
+  int start = 0;
+  int end = count;
+  while (start < end) {
+    const int middle = start + ((end - start) / 2);
+    if (sorted_times[middle] <= time) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+}  // namespace
+
+SkylineMemoryPlanner::SkylineMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size) : buffer_count_(0), arena_size_(0), need_to_calculate_offsets_(true) {
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / kPerBufferScratchSize;
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_array);
+  next_array += max_buffer_count_ * kIntsPerRequirements;
+  int** const arrays[] = {
+      &buffer_offsets_, &first_times_sorted_, &buffer_ids_in_placement_order_, &placement_order_keys_, &sort_scratch_values_, &sort_scratch_ids_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  subtree_max_heights_ = next_array;
+  next_array += max_buffer_count_ * kTreeNodesPerBuffer;
+  subtree_raised_heights_ = next_array;
+}
+
+SkylineMemoryPlanner::~SkylineMemoryPlanner() {}
+
+bool SkylineMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool SkylineMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  BufferRequirements* current = &requirements_[buffer_count_];
+  current->size = size;
+  current->first_time_used = first_time_used;
+  current->last_time_used = last_time_used;
+  current->alignment = alignment;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+int SkylineMemoryPlanner::FindMaximumHeight(int node, int node_start, int node_end, int start, int end) const {
+  if ((start <= node_start) && (node_end <= end)) {
+    return subtree_max_heights_[node];
+  }
+  // Anything raising the whole node also raises the part being asked about.
+  int height = subtree_raised_heights_[node];
+  const int middle = node_start + ((node_end - node_start) / 2);
+  if (start < middle) {
+    const int left_height = FindMaximumHeight(node * 2, node_start, middle, start, end);
+    if (left_height > height) {
+      height = left_height;
+    }
+  }
+  if (end > middle) {
+    const int right_height = FindMaximumHeight((node * 2) + 1, middle, node_end, start, end);
+    if (right_height > height) {
+      height = right_height;
+    }
+  }
+  return height;
+}
+
+void SkylineMemoryPlanner::RaiseHeight(int node, int node_start, int node_end, int start, int end, int height) {
+  if ((start <= node_start) && (node_end <= end)) {
+    if (height > subtree_max_heights_[node]) {
+      subtree_max_heights_[node] = height;
+    }
+    if (height > subtree_raised_heights_[node]) {
+      subtree_raised_heights_[node] = height;
+    }
+    return;
+  }
+  const int middle = node_start + ((node_end - node_start) / 2);
+  if (start < middle) {
+    RaiseHeight(node * 2, node_start, middle, start, end, height);
+  }
+  if (end > middle) {
+    RaiseHeight((node * 2) + 1, middle, node_end, start, end, height);
+  }
+  int max_height = subtree_raised_heights_[node];
+  if (subtree_max_heights_[node * 2] > max_height) {
+    max_height = subtree_max_heights_[node * 2];
+  }
+  if (subtree_max_heights_[(node * 2) + 1] > max_height) {
+    max_height = subtree_max_heights_[(node * 2) + 1];
+  }
+  subtree_max_heights_[node] = max_height;
+}
+
+void SkylineMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  arena_size_ = 0;
+  if (buffer_count_ == 0) {
+    return;
+  }
+
+  // The sort needs an ids array to rearrange, so the placement order array
+  // is borrowed for it before it's filled in properly.
+  for (int i = 0; i < buffer_count_; ++i) {
+    first_times_sorted_[i] = requirements_[i].first_time_used;
+    buffer_ids_in_placement_order_[i] = i;
+  }
+  SortWithScratch(first_times_sorted_, buffer_ids_in_placement_order_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+  // Nothing is ever placed underneath the skyline, so a buffer that's long
+  // lived and large raises it for everything that comes after. Placing in
+  // order of area, clamped to fit in an int, gives the smallest arenas.
+  for (int i = 0; i < buffer_count_; ++i) {
+    const BufferRequirements* requirements = &requirements_[i];
+    const int64_t area = static_cast<int64_t>(requirements->size) * ((requirements->last_time_used - requirements->first_time_used) + 1);
+    placement_order_keys_[i] = (area > kMaxPlacementOrderKey) ? kMaxPlacementOrderKey : static_cast<int>(area);
+    buffer_ids_in_placement_order_[i] = i;
+  }
+  ReverseSortWithScratch(placement_order_keys_, buffer_ids_in_placement_order_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+
+  // Only the nodes a tree over buffer_count_ leaves can reach need clearing.
+  const int tree_node_count = buffer_count_ * kTreeNodesPerBuffer;
+  for (int i = 0; i < tree_node_count; ++i) {
+    subtree_max_heights_[i] = 0;
+    subtree_raised_heights_[i] = 0;
+  }
+
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_in_placement_order_[i];
+    const BufferRequirements* requirements = &requirements_[buffer_id];
+    // The leaves for the first uses that happen while this buffer is in use.
+    // Its own first use is one of them, unless it's last used before it's
+    // first used, and then it still gets a leaf so that it's placed.
+    const int start = FindFirstPositionAtOrAfter(first_times_sorted_, buffer_count_, requirements->first_time_used);
+    int end = FindFirstPositionAfter(first_times_sorted_, buffer_count_, requirements->last_time_used);
+    if (end <= start) {
+      end = start + 1;
+    }
+    const int offset = AlignOffset(FindMaximumHeight(1, 0, buffer_count_, start, end), requirements->alignment);
+    const int top = offset + requirements->size;
+    RaiseHeight(1, 0, buffer_count_, start, end, top);
+    buffer_offsets_[buffer_id] = offset;
+    if (top > arena_size_) {
+      arena_size_ = top;
+    }
+  }
+}
+
+int SkylineMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return arena_size_;
+}
+
+int SkylineMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool SkylineMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+}  // namespace tflite
@@ -0,0 +1,96 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "greedy_memory_planner.h"
+#include "memory_plan_verifier.h"
+#include "skyline_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestSkylineBasics) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The same buffers as TestGreedyMedium. The greedy planner fits the
+  // smallest buffer into the gap at 50, but stacking puts it on top of the
+  // skyline at 90, so the arena is 100 bytes rather than 90.
+  constexpr int scratch_buffer_size = tflite::SkylineMemoryPlanner::GetScratchBufferSize(6);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SkylineMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 3, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(5, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(100, planner.GetMaximumMemorySize());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 4, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 3, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 2, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(40, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(70, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(90, offset);
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 5, &offset));
+
+  // An aligned buffer sits on the next multiple above the skyline.
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 8, 4, 4, 12));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 8, 4, 4, 16));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 5, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(48, offset);
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 8, 4, 4));
+}
+
+TF_LITE_MICRO_TEST(TestSkylineManyBuffers) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 1000;
+  constexpr int scratch_buffer_size = tflite::SkylineMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  constexpr int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char greedy_scratch_buffer[greedy_scratch_buffer_size];
+  tflite::BufferRequirements requirements[buffer_count];
+  static int verify_scratch[tflite::GetVerifyMemoryPlanScratchCount(buffer_count)];
+  unsigned int seed = 1;
+  tflite::SkylineMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    tflite::BufferRequirements* current = &requirements[i];
+    seed = (seed * 1103515245) + 12345;
+    current->size = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    current->first_time_used = (seed >> 16) % 500;
+    seed = (seed * 1103515245) + 12345;
+    current->last_time_used = current->first_time_used + ((seed >> 16) % 20);
+    current->alignment = 1 << (i % 4);
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, current->size, current->first_time_used, current->last_time_used, current->alignment));
+    TF_LITE_MICRO_EXPECT_EQ(true, greedy_planner.AddBuffer(error_reporter, current->size, current->first_time_used, current->last_time_used, current->alignment));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, tflite::VerifyMemoryPlan(error_reporter, &planner, requirements, buffer_count, verify_scratch));
+  // Stacking wastes the space under the skyline, but shouldn't be too far
+  // behind the gap search.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetMaximumMemorySize() < (greedy_planner.GetMaximumMemorySize() * 2));
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -0,0 +1,248 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STATIC_GREEDY_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STATIC_GREEDY_MEMORY_PLANNER_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "greedy_memory_planner.h"
+#include "greedy_placement.h"
+#include "memory_planner.h"
+
+namespace tflite {
+
+// A greedy planner whose capacity and field widths are fixed at compile time,
+// for small cores where planning should stay within the L1 cache. All of its
+// working memory is inside the object, stored with the narrowest types the
+// model allows. For example, a model with at most 255 tensors, fewer than 64KB
+// of arena and fewer than 65536 operations can use:
+//
+//   StaticGreedyMemoryPlanner<255, uint8_t, uint16_t, uint16_t>
+//
+// which needs 14 bytes per buffer, against 84 for GreedyMemoryPlanner.
+//
+// It gives the same offsets as GreedyMemoryPlanner for the same buffers,
+// ordering and gap policy. It finds the active buffers with a linear scan
+// rather than GreedyMemoryPlanner's time index though, so planning takes
+// O(N^2) time and is meant for the small graphs that narrow indices allow.
+// Alias pairs, fixed offsets and refinement aren't supported. Like the other
+// template-only planners, this needs C++14.
+template <int kMaxBufferCount, typename IndexType = int, typename OffsetType = int, typename TimeType = int>
+class StaticGreedyMemoryPlanner : public MemoryPlanner {
+ public:
+  static_assert(kMaxBufferCount > 0, "The planner must be able to hold at least one buffer");
+  static_assert((kMaxBufferCount - 1) <= static_cast<int64_t>(std::numeric_limits<IndexType>::max()), "IndexType is too narrow for kMaxBufferCount buffers");
+
+  StaticGreedyMemoryPlanner();
+  virtual ~StaticGreedyMemoryPlanner() override {}
+
+  // Changes the order buffers are placed in. See GreedyMemoryPlanner.
+  void SetBufferOrdering(GreedyMemoryPlanner::BufferOrdering ordering);
+
+  // Changes how gaps are chosen. See GreedyMemoryPlanner.
+  void SetGapSelectionPolicy(GreedyMemoryPlanner::GapSelectionPolicy policy);
+
+  // Sizes and times must fit in OffsetType and TimeType, and are rejected
+  // with an error if they don't.
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+
+  // If the plan would need offsets too large for OffsetType, this returns
+  // zero and GetOffsetForBuffer() reports the error.
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override { return buffer_count_; }
+  virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+ private:
+  void GetRequirements(int buffer_id, BufferRequirements* requirements) const;
+  void CalculateOffsetsIfNeeded();
+
+  OffsetType sizes_[kMaxBufferCount];
+  TimeType first_times_used_[kMaxBufferCount];
+  TimeType last_times_used_[kMaxBufferCount];
+  // Alignments are powers of two, so only the exponent is kept.
+  uint8_t alignment_shifts_[kMaxBufferCount];
+  OffsetType buffer_offsets_[kMaxBufferCount];
+  IndexType buffer_ids_in_placement_order_[kMaxBufferCount];
+  // The placed buffers active at the same time as the one being placed, in
+  // ascending order of offset.
+  OffsetType active_offsets_[kMaxBufferCount];
+  OffsetType active_ends_[kMaxBufferCount];
+
+  int buffer_count_;
+  int arena_size_;
+  bool need_to_calculate_offsets_;
+  bool plan_fits_offset_type_;
+  GreedyMemoryPlanner::BufferOrdering buffer_ordering_;
+  GreedyMemoryPlanner::GapSelectionPolicy gap_selection_policy_;
+};
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::StaticGreedyMemoryPlanner()
+    : buffer_count_(0),
+      arena_size_(0),
+      need_to_calculate_offsets_(true),
+      plan_fits_offset_type_(true),
+      buffer_ordering_(GreedyMemoryPlanner::kSizeDescending),
+      gap_selection_policy_(GreedyMemoryPlanner::kFirstFit) {}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+void StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::SetBufferOrdering(GreedyMemoryPlanner::BufferOrdering ordering) {
+  buffer_ordering_ = ordering;
+  need_to_calculate_offsets_ = true;
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+void StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::SetGapSelectionPolicy(GreedyMemoryPlanner::GapSelectionPolicy policy) {
+  gap_selection_policy_ = policy;
+  need_to_calculate_offsets_ = true;
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+bool StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+bool StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= kMaxBufferCount) {
+    error_reporter->Report("Too many buffers (max is %d)", kMaxBufferCount);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  if ((size < 0) || (size > static_cast<int64_t>(std::numeric_limits<OffsetType>::max()))) {
+    error_reporter->Report("Buffer size %d doesn't fit in the offset type", size);
+    return false;
+  }
+  const int64_t min_time = std::numeric_limits<TimeType>::min();
+  const int64_t max_time = std::numeric_limits<TimeType>::max();
+  if ((first_time_used < min_time) || (first_time_used > max_time) || (last_time_used < min_time) || (last_time_used > max_time)) {
+    error_reporter->Report("Buffer times %d to %d don't fit in the time type", first_time_used, last_time_used);
+    return false;
+  }
+  int alignment_shift = 0;
+  while ((1 << alignment_shift) < alignment) {
+    ++alignment_shift;
+  }
+  sizes_[buffer_count_] = static_cast<OffsetType>(size);
+  first_times_used_[buffer_count_] = static_cast<TimeType>(first_time_used);
+  last_times_used_[buffer_count_] = static_cast<TimeType>(last_time_used);
+  alignment_shifts_[buffer_count_] = static_cast<uint8_t>(alignment_shift);
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+void StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::GetRequirements(int buffer_id, BufferRequirements* requirements) const {
+  requirements->size = sizes_[buffer_id];
+  requirements->first_time_used = first_times_used_[buffer_id];
+  requirements->last_time_used = last_times_used_[buffer_id];
+  requirements->alignment = 1 << alignment_shifts_[buffer_id];
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+void StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  arena_size_ = 0;
+  plan_fits_offset_type_ = true;
+
+  // A stable insertion sort into placement order, recalculating the keys
+  // rather than storing them so the working memory stays small.
+  for (int i = 0; i < buffer_count_; ++i) {
+    BufferRequirements requirements;
+    GetRequirements(i, &requirements);
+    const int key = internal::GetGreedyPlacementOrderKey(requirements, buffer_ordering_);
+    int position = i;
+    while (position > 0) {
+      BufferRequirements previous_requirements;
+      GetRequirements(buffer_ids_in_placement_order_[position - 1], &previous_requirements);
+      if (!internal::IsEarlierInGreedyPlacementOrder(key, internal::GetGreedyPlacementOrderKey(previous_requirements, buffer_ordering_), buffer_ordering_)) {
+        break;
+      }
+      buffer_ids_in_placement_order_[position] = buffer_ids_in_placement_order_[position - 1];
+      --position;
+    }
+    buffer_ids_in_placement_order_[position] = static_cast<IndexType>(i);
+  }
+
+  const int64_t max_offset = std::numeric_limits<OffsetType>::max();
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_in_placement_order_[i];
+    BufferRequirements wanted;
+    GetRequirements(buffer_id, &wanted);
+    int active_count = 0;
+    for (int j = 0; j < i; ++j) {
+      const int placed_id = buffer_ids_in_placement_order_[j];
+      if ((first_times_used_[placed_id] > wanted.last_time_used) || (last_times_used_[placed_id] < wanted.first_time_used)) {
+        continue;
+      }
+      const OffsetType placed_offset = buffer_offsets_[placed_id];
+      int position = active_count;
+      while ((position > 0) && (active_offsets_[position - 1] > placed_offset)) {
+        active_offsets_[position] = active_offsets_[position - 1];
+        active_ends_[position] = active_ends_[position - 1];
+        --position;
+      }
+      active_offsets_[position] = placed_offset;
+      active_ends_[position] = static_cast<OffsetType>(placed_offset + sizes_[placed_id]);
+      ++active_count;
+    }
+    const int offset = internal::ChooseGreedyOffset(active_offsets_, active_ends_, active_count, wanted.size, wanted.alignment, gap_selection_policy_);
+    const int64_t end = static_cast<int64_t>(offset) + wanted.size;
+    if (end > max_offset) {
+      plan_fits_offset_type_ = false;
+      arena_size_ = 0;
+      return;
+    }
+    buffer_offsets_[buffer_id] = static_cast<OffsetType>(offset);
+    if (end > arena_size_) {
+      arena_size_ = static_cast<int>(end);
+    }
+  }
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+int StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return arena_size_;
+}
+
+template <int kMaxBufferCount, typename IndexType, typename OffsetType, typename TimeType>
+bool StaticGreedyMemoryPlanner<kMaxBufferCount, IndexType, OffsetType, TimeType>::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  if (!plan_fits_offset_type_) {
+    error_reporter->Report("Plan needs offsets larger than the offset type can hold (max is %d)", static_cast<int>(std::numeric_limits<OffsetType>::max()));
+    return false;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STATIC_GREEDY_MEMORY_PLANNER_H_
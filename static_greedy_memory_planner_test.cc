@@ -0,0 +1,102 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "static_greedy_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestStaticGreedyMatchesGreedy) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  typedef tflite::StaticGreedyMemoryPlanner<255, uint8_t, uint16_t, uint16_t> SmallPlanner;
+  static_assert(sizeof(SmallPlanner) < (255 * 16), "The narrow planner should need far less than GreedyMemoryPlanner's 84 bytes per buffer");
+
+  constexpr int buffer_count = 255;
+  constexpr int scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  const tflite::GreedyMemoryPlanner::BufferOrdering orderings[] = {
+      tflite::GreedyMemoryPlanner::kSizeDescending,
+      tflite::GreedyMemoryPlanner::kLifetimeDescending,
+      tflite::GreedyMemoryPlanner::kAreaDescending,
+      tflite::GreedyMemoryPlanner::kFirstUseAscending,
+  };
+  const tflite::GreedyMemoryPlanner::GapSelectionPolicy policies[] = {
+      tflite::GreedyMemoryPlanner::kFirstFit,
+      tflite::GreedyMemoryPlanner::kBestFit,
+      tflite::GreedyMemoryPlanner::kWorstFit,
+      tflite::GreedyMemoryPlanner::kFirstFit,
+  };
+  static SmallPlanner small_planners[4];
+  for (int p = 0; p < 4; ++p) {
+    SmallPlanner& small_planner = small_planners[p];
+    tflite::GreedyMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+    planner.SetBufferOrdering(orderings[p]);
+    planner.SetGapSelectionPolicy(policies[p]);
+    small_planner.SetBufferOrdering(orderings[p]);
+    small_planner.SetGapSelectionPolicy(policies[p]);
+    unsigned int seed = 1;
+    for (int i = 0; i < buffer_count; ++i) {
+      seed = (seed * 1103515245) + 12345;
+      const int size = ((seed >> 16) % 200) + 1;
+      seed = (seed * 1103515245) + 12345;
+      const int first_time_used = (seed >> 16) % 100;
+      seed = (seed * 1103515245) + 12345;
+      const int last_time_used = first_time_used + ((seed >> 16) % 10);
+      const int alignment = 1 << (i % 4);
+      TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, size, first_time_used, last_time_used, alignment));
+      TF_LITE_MICRO_EXPECT_EQ(true, small_planner.AddBuffer(error_reporter, size, first_time_used, last_time_used, alignment));
+    }
+    TF_LITE_MICRO_EXPECT_EQ(buffer_count, small_planner.GetBufferCount());
+    TF_LITE_MICRO_EXPECT_EQ(planner.GetMaximumMemorySize(), small_planner.GetMaximumMemorySize());
+    for (int i = 0; i < buffer_count; ++i) {
+      int offset = -1;
+      int small_offset = -2;
+      planner.GetOffsetForBuffer(error_reporter, i, &offset);
+      TF_LITE_MICRO_EXPECT_EQ(true, small_planner.GetOffsetForBuffer(error_reporter, i, &small_offset));
+      TF_LITE_MICRO_EXPECT_EQ(offset, small_offset);
+    }
+  }
+}
+
+TF_LITE_MICRO_TEST(TestStaticGreedyTypeLimits) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  tflite::StaticGreedyMemoryPlanner<2, uint8_t, uint8_t, uint8_t> planner;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 256, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 0, 256));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, -1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 0, 1, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 200, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 60, 1, 2, 8));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 0, 1));
+
+  // Each buffer fits on its own, but together they need offsets past 255.
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetMaximumMemorySize());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+
+  tflite::StaticGreedyMemoryPlanner<2, uint8_t, uint8_t, uint8_t> fitting_planner;
+  TF_LITE_MICRO_EXPECT_EQ(true, fitting_planner.AddBuffer(error_reporter, 200, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, fitting_planner.AddBuffer(error_reporter, 50, 2, 3, 8));
+  TF_LITE_MICRO_EXPECT_EQ(200, fitting_planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, fitting_planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -0,0 +1,320 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "streaming_memory_planner.h"
+
+#include <cstdint>
+
+namespace tflite {
+namespace {
+
+// Treap priorities are derived from the node index, so plans are
+// deterministic. The mixing keeps them independent of the gap offsets.
+uint32_t GetGapNodePriority(int node) {
+  uint32_t value = static_cast<uint32_t>(node) + 0x9e3779b9u;
+  value = (value ^ (value >> 16)) * 0x85ebca6bu;
+  value = (value ^ (value >> 13)) * 0xc2b2ae35u;
+  return value ^ (value >> 16);
+}
+
+}  // namespace
+
+StreamingMemoryPlanner::StreamingMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size)
+    : buffer_count_(0),
+      latest_first_time_used_(0),
+      arena_top_(0),
+      peak_arena_size_(0),
+      current_memory_size_(0),
+      live_buffer_count_(0),
+      gap_root_(-1),
+      first_free_gap_node_(-1) {
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / kPerBufferScratchSize;
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  int** const arrays[] = {
+      &buffer_offsets_, &buffer_sizes_, &last_times_used_, &live_buffer_heap_, &gap_starts_, &gap_ends_, &gap_left_children_, &gap_right_children_, &subtree_max_gap_lengths_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  for (int node = max_buffer_count_ - 1; node >= 0; --node) {
+    gap_left_children_[node] = first_free_gap_node_;
+    first_free_gap_node_ = node;
+  }
+}
+
+StreamingMemoryPlanner::~StreamingMemoryPlanner() {}
+
+bool StreamingMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool StreamingMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  if ((buffer_count_ > 0) && (first_time_used < latest_first_time_used_)) {
+    error_reporter->Report("Buffer first used at %d was added after one first used at %d", first_time_used, latest_first_time_used_);
+    return false;
+  }
+  latest_first_time_used_ = first_time_used;
+  ReleaseBuffersBefore(first_time_used);
+
+  const int buffer_index = buffer_count_;
+  buffer_offsets_[buffer_index] = AllocateOffset(size, alignment);
+  buffer_sizes_[buffer_index] = size;
+  last_times_used_[buffer_index] = last_time_used;
+  PushLiveBuffer(buffer_index);
+  ++buffer_count_;
+  current_memory_size_ += size;
+  if (arena_top_ > peak_arena_size_) {
+    peak_arena_size_ = arena_top_;
+  }
+  return true;
+}
+
+void StreamingMemoryPlanner::ReleaseBuffersBefore(int time) {
+  while ((live_buffer_count_ > 0) && (last_times_used_[live_buffer_heap_[0]] < time)) {
+    const int buffer_index = PopLiveBuffer();
+    const int offset = buffer_offsets_[buffer_index];
+    FreeRange(offset, offset + buffer_sizes_[buffer_index]);
+    current_memory_size_ -= buffer_sizes_[buffer_index];
+  }
+}
+
+int StreamingMemoryPlanner::AllocateOffset(int size, int alignment) {
+  // Empty buffers can't overlap anything, and placing them at the top could
+  // leave a gap touching it.
+  if (size <= 0) {
+    return 0;
+  }
+  const int node = FindFirstFit(gap_root_, size, alignment);
+  if (node == -1) {
+    const int start = arena_top_;
+    const int offset = AlignOffset(start, alignment);
+    arena_top_ = offset + size;
+    InsertGap(start, offset);
+    return offset;
+  }
+  const int start = gap_starts_[node];
+  const int end = gap_ends_[node];
+  const int offset = AlignOffset(start, alignment);
+  RemoveGap(node);
+  InsertGap(start, offset);
+  InsertGap(offset + size, end);
+  return offset;
+}
+
+void StreamingMemoryPlanner::FreeRange(int start, int end) {
+  if (start >= end) {
+    return;
+  }
+  int before;
+  int after;
+  SplitGaps(gap_root_, start, &before, &after);
+
+  // Take the last gap before the range if it ends where the range starts.
+  int previous = before;
+  while ((previous != -1) && (gap_right_children_[previous] != -1)) {
+    previous = gap_right_children_[previous];
+  }
+  if ((previous != -1) && (gap_ends_[previous] == start)) {
+    start = gap_starts_[previous];
+    int previous_node;
+    SplitGaps(before, start, &before, &previous_node);
+    DeleteGapNode(previous_node);
+  }
+
+  // Likewise for the first gap after the range.
+  int next = after;
+  while ((next != -1) && (gap_left_children_[next] != -1)) {
+    next = gap_left_children_[next];
+  }
+  if ((next != -1) && (gap_starts_[next] == end)) {
+    end = gap_ends_[next];
+    int next_node;
+    SplitGaps(after, end, &next_node, &after);
+    DeleteGapNode(next_node);
+  }
+
+  // Space that reaches the top of the arena isn't a gap any more.
+  if (end == arena_top_) {
+    arena_top_ = start;
+    gap_root_ = MergeGaps(before, after);
+    return;
+  }
+  gap_root_ = MergeGaps(MergeGaps(before, NewGapNode(start, end)), after);
+}
+
+int StreamingMemoryPlanner::FindFirstFit(int node, int size, int alignment) const {
+  if ((node == -1) || (subtree_max_gap_lengths_[node] < size)) {
+    return -1;
+  }
+  const int left_fit = FindFirstFit(gap_left_children_[node], size, alignment);
+  if (left_fit != -1) {
+    return left_fit;
+  }
+  if ((AlignOffset(gap_starts_[node], alignment) + size) <= gap_ends_[node]) {
+    return node;
+  }
+  return FindFirstFit(gap_right_children_[node], size, alignment);
+}
+
+int StreamingMemoryPlanner::NewGapNode(int start, int end) {
+  const int node = first_free_gap_node_;
+  first_free_gap_node_ = gap_left_children_[node];
+  gap_starts_[node] = start;
+  gap_ends_[node] = end;
+  gap_left_children_[node] = -1;
+  gap_right_children_[node] = -1;
+  subtree_max_gap_lengths_[node] = end - start;
+  return node;
+}
+
+void StreamingMemoryPlanner::DeleteGapNode(int node) {
+  gap_left_children_[node] = first_free_gap_node_;
+  first_free_gap_node_ = node;
+}
+
+void StreamingMemoryPlanner::UpdateGapNode(int node) {
+  int max_gap_length = gap_ends_[node] - gap_starts_[node];
+  const int children[] = {gap_left_children_[node], gap_right_children_[node]};
+  for (int child : children) {
+    if ((child != -1) && (subtree_max_gap_lengths_[child] > max_gap_length)) {
+      max_gap_length = subtree_max_gap_lengths_[child];
+    }
+  }
+  subtree_max_gap_lengths_[node] = max_gap_length;
+}
+
+void StreamingMemoryPlanner::SplitGaps(int node, int start, int* before, int* at_or_after) {
+  if (node == -1) {
+    *before = -1;
+    *at_or_after = -1;
+    return;
+  }
+  if (gap_starts_[node] < start) {
+    SplitGaps(gap_right_children_[node], start, &gap_right_children_[node], at_or_after);
+    *before = node;
+  } else {
+    SplitGaps(gap_left_children_[node], start, before, &gap_left_children_[node]);
+    *at_or_after = node;
+  }
+  UpdateGapNode(node);
+}
+
+int StreamingMemoryPlanner::MergeGaps(int left, int right) {
+  if (left == -1) {
+    return right;
+  }
+  if (right == -1) {
+    return left;
+  }
+  if (GetGapNodePriority(left) > GetGapNodePriority(right)) {
+    gap_right_children_[left] = MergeGaps(gap_right_children_[left], right);
+    UpdateGapNode(left);
+    return left;
+  }
+  gap_left_children_[right] = MergeGaps(left, gap_left_children_[right]);
+  UpdateGapNode(right);
+  return right;
+}
+
+void StreamingMemoryPlanner::InsertGap(int start, int end) {
+  if (start >= end) {
+    return;
+  }
+  int before;
+  int after;
+  SplitGaps(gap_root_, start, &before, &after);
+  gap_root_ = MergeGaps(MergeGaps(before, NewGapNode(start, end)), after);
+}
+
+void StreamingMemoryPlanner::RemoveGap(int node) {
+  int before;
+  int rest;
+  int after;
+  SplitGaps(gap_root_, gap_starts_[node], &before, &rest);
+  SplitGaps(rest, gap_starts_[node] + 1, &rest, &after);
+  DeleteGapNode(node);
+  gap_root_ = MergeGaps(before, after);
+}
+
+void StreamingMemoryPlanner::PushLiveBuffer(int buffer_index) {
+  int position = live_buffer_count_;
+  ++live_buffer_count_;
+  while (position > 0) {
+    const int parent = (position - 1) / 2;
+    if (last_times_used_[live_buffer_heap_[parent]] <= last_times_used_[buffer_index]) {
+      break;
+    }
+    live_buffer_heap_[position] = live_buffer_heap_[parent];
+    position = parent;
+  }
+  live_buffer_heap_[position] = buffer_index;
+}
+
+int StreamingMemoryPlanner::PopLiveBuffer() {
+  const int result = live_buffer_heap_[0];
+  --live_buffer_count_;
+  const int last = live_buffer_heap_[live_buffer_count_];
+  int position = 0;
+  while (true) {
+    int child = (position * 2) + 1;
+    if (child >= live_buffer_count_) {
+      break;
+    }
+    if (((child + 1) < live_buffer_count_) && (last_times_used_[live_buffer_heap_[child + 1]] < last_times_used_[live_buffer_heap_[child]])) {
+      ++child;
+    }
+    if (last_times_used_[last] <= last_times_used_[live_buffer_heap_[child]]) {
+      break;
+    }
+    live_buffer_heap_[position] = live_buffer_heap_[child];
+    position = child;
+  }
+  live_buffer_heap_[position] = last;
+  return result;
+}
+
+int StreamingMemoryPlanner::GetMaximumMemorySize() { return peak_arena_size_; }
+
+int StreamingMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool StreamingMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+int StreamingMemoryPlanner::GetCurrentMemorySize() { return current_memory_size_; }
+
+}  // namespace tflite
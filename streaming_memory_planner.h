@@ -0,0 +1,131 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STREAMING_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STREAMING_MEMORY_PLANNER_H_
+
+#include "memory_planner.h"
+
+namespace tflite {
+
+// A planner for runtimes that only learn each buffer's size as execution
+// reaches it. Rather than waiting for the whole graph, it gives every buffer
+// its offset as soon as AddBuffer() is called, so GetOffsetForBuffer() can be
+// used straight away. Buffers have to be added in order of first use. Before
+// placing a new buffer, any whose last use is earlier than its first use are
+// released, and the new one goes in the lowest free gap it fits in, or on top
+// of the arena if there isn't one.
+//
+// The free gaps are kept in a treap ordered by offset, where each node also
+// records the largest gap in its subtree, and the live buffers are kept in a
+// heap ordered by last use. Each buffer is pushed and popped once and causes
+// a constant number of gap insertions and removals, so planning takes
+// amortized O(log N) time per buffer. Finding a gap is exact in O(log N) for
+// the default alignment. With larger alignments a gap can be long enough but
+// still not fit once its start is aligned, and the search then carries on to
+// later gaps.
+//
+// Since it can't look ahead, the arena is usually larger than an offline
+// planner like GreedyMemoryPlanner would give for the same buffers. As with
+// the other planners, all working memory comes from a scratch buffer owned by
+// the client.
+class StreamingMemoryPlanner : public MemoryPlanner {
+ public:
+  StreamingMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
+  virtual ~StreamingMemoryPlanner() override;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including room for alignment.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * kPerBufferScratchSize) + (kScratchAlignment - 1);
+  }
+
+  // Fails if first_time_used is earlier than that of the previous buffer.
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+
+  // The peak arena size over all the buffers added so far.
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // How many bytes the buffers in use at the most recent first use take up.
+  int GetCurrentMemorySize();
+
+ private:
+  // Releases every buffer whose last use is before this time.
+  void ReleaseBuffersBefore(int time);
+
+  // Finds a place for a buffer, updating the free gaps.
+  int AllocateOffset(int size, int alignment);
+
+  // Returns a range to the free space, joining it with any neighboring gaps.
+  void FreeRange(int start, int end);
+
+  // The leftmost gap that a buffer with this size and alignment fits into,
+  // or -1 if there isn't one.
+  int FindFirstFit(int node, int size, int alignment) const;
+
+  // Treap operations on the free gaps, keyed by their start offsets.
+  int NewGapNode(int start, int end);
+  void DeleteGapNode(int node);
+  void UpdateGapNode(int node);
+  void SplitGaps(int node, int start, int* before, int* at_or_after);
+  int MergeGaps(int left, int right);
+  void InsertGap(int start, int end);
+  void RemoveGap(int node);
+
+  // Binary min-heap of live buffer ids, ordered by last use.
+  void PushLiveBuffer(int buffer_index);
+  int PopLiveBuffer();
+
+  static constexpr int kScratchAlignment = alignof(int);
+
+  // Every free gap is followed by a live buffer, so there are never more
+  // gaps than buffers. Each gap node has a start, an end, two children and
+  // the largest gap length in its subtree, and each buffer has an offset, a
+  // size, a last use and a heap slot.
+  static constexpr int kIntsPerGapNode = 5;
+  static constexpr int kIntsPerBuffer = 4;
+  static constexpr int kPerBufferScratchSize = (kIntsPerGapNode + kIntsPerBuffer) * sizeof(int);
+
+  int max_buffer_count_;
+  int buffer_count_;
+  int latest_first_time_used_;
+
+  // Everything at or above this offset is free.
+  int arena_top_;
+  int peak_arena_size_;
+  int current_memory_size_;
+
+  int* buffer_offsets_;
+  int* buffer_sizes_;
+  int* last_times_used_;
+  int* live_buffer_heap_;
+  int live_buffer_count_;
+
+  int* gap_starts_;
+  int* gap_ends_;
+  int* gap_left_children_;
+  int* gap_right_children_;
+  int* subtree_max_gap_lengths_;
+  int gap_root_;
+  // Unused nodes, linked through gap_left_children_.
+  int first_free_gap_node_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_STREAMING_MEMORY_PLANNER_H_
@@ -0,0 +1,130 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "streaming_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestStreamingBasics) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::StreamingMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::StreamingMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(0, planner.GetMaximumMemorySize());
+
+  // Offsets are available as soon as each buffer is added.
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 0, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(0, offset);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 1, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(100, offset);
+  TF_LITE_MICRO_EXPECT_EQ(150, planner.GetMaximumMemorySize());
+
+  // The first buffer has finished, so this one reuses its space.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 30, 2, 3));
+  // Releasing the second buffer joins its space with the gap below it and
+  // the top of the arena, so this one sits directly above the third.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 3, 3));
+  // Everything has been released, so these start from the bottom again.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 20, 4, 4));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 4, 5, 16));
+  // This fills the space below the aligned buffer.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 8, 5, 5));
+  TF_LITE_MICRO_EXPECT_EQ(7, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(150, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(18, planner.GetCurrentMemorySize());
+
+  const int expected_offsets[] = {0, 100, 0, 30, 0, 32, 0};
+  for (int i = 0; i < 7; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 7, &offset));
+}
+
+TF_LITE_MICRO_TEST(TestStreamingErrorHandling) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::StreamingMemoryPlanner::GetScratchBufferSize(2);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::StreamingMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 3, 4));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 2, 4));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 3, 4, 3));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 0, 3, 4, 16));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 5, 5));
+  TF_LITE_MICRO_EXPECT_EQ(2, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(10, planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TEST(TestStreamingManyBuffers) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int buffer_count = 1000;
+  constexpr int scratch_buffer_size = tflite::StreamingMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::StreamingMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  static int sizes[buffer_count];
+  static int first_times_used[buffer_count];
+  static int last_times_used[buffer_count];
+  static int alignments[buffer_count];
+  unsigned int seed = 1;
+  int first_time_used = 0;
+  for (int i = 0; i < buffer_count; ++i) {
+    seed = (seed * 1103515245) + 12345;
+    sizes[i] = ((seed >> 16) % 1000) + 1;
+    seed = (seed * 1103515245) + 12345;
+    first_time_used += (seed >> 16) % 2;
+    seed = (seed * 1103515245) + 12345;
+    first_times_used[i] = first_time_used;
+    last_times_used[i] = first_time_used + ((seed >> 16) % 20);
+    seed = (seed * 1103515245) + 12345;
+    alignments[i] = 1 << ((seed >> 16) % 5);
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, sizes[i], first_times_used[i], last_times_used[i], alignments[i]));
+  }
+
+  // Every buffer has to be aligned, inside the arena, and clear of any other
+  // buffer that's in use at the same time.
+  const int arena_size = planner.GetMaximumMemorySize();
+  bool all_valid = true;
+  for (int i = 0; i < buffer_count; ++i) {
+    int offset = -1;
+    planner.GetOffsetForBuffer(error_reporter, i, &offset);
+    if ((offset < 0) || ((offset % alignments[i]) != 0) || ((offset + sizes[i]) > arena_size)) {
+      all_valid = false;
+    }
+    for (int j = 0; j < i; ++j) {
+      if ((first_times_used[i] > last_times_used[j]) || (first_times_used[j] > last_times_used[i])) {
+        continue;
+      }
+      int other_offset = -1;
+      planner.GetOffsetForBuffer(error_reporter, j, &other_offset);
+      if ((offset < (other_offset + sizes[j])) && (other_offset < (offset + sizes[i]))) {
+        all_valid = false;
+      }
+    }
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, all_valid);
+}
+
+TF_LITE_MICRO_TESTS_END
@@ -0,0 +1,326 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "symbolic_memory_planner.h"
+
+#include <cstdint>
+
+#include "micro_error_reporter.h"
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+
+SymbolicMemoryPlanner::SymbolicMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size)
+    : buffer_count_(0),
+      arena_size_(0),
+      dimension_values_{},
+      need_to_calculate_offsets_(true),
+      have_buffers_changed_(true),
+      is_arrangement_recorded_(false),
+      was_last_plan_reused_(false) {
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding - static_cast<int>(sizeof(int))) / (kPerBufferScratchSize + kGreedyScratchPerBuffer);
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  max_overlap_count_ = max_buffer_count_ * kOverlapsPerBuffer;
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  symbolic_sizes_ = reinterpret_cast<SymbolicBufferSize*>(next_array);
+  next_array += max_buffer_count_ * kIntsPerSymbolicSize;
+  int** const arrays[] = {
+      &first_times_used_, &last_times_used_, &alignments_, &sizes_, &buffer_offsets_, &buffer_ids_in_placement_order_, &sort_values_, &sort_ids_, &sort_scratch_values_, &sort_scratch_ids_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  overlap_starts_ = next_array;
+  next_array += max_buffer_count_ + 1;
+  overlaps_ = next_array;
+  next_array += max_overlap_count_;
+  greedy_scratch_buffer_ = reinterpret_cast<unsigned char*>(next_array);
+}
+
+SymbolicMemoryPlanner::~SymbolicMemoryPlanner() {}
+
+bool SymbolicMemoryPlanner::SetDimensionValue(tflite::ErrorReporter* error_reporter, int dimension, int value) {
+  if ((dimension < 0) || (dimension >= kMaxSymbolicDimensionCount)) {
+    error_reporter->Report("Dimension %d is outside range 0 to %d", dimension, kMaxSymbolicDimensionCount);
+    return false;
+  }
+  if (dimension_values_[dimension] != value) {
+    dimension_values_[dimension] = value;
+    need_to_calculate_offsets_ = true;
+  }
+  return true;
+}
+
+bool SymbolicMemoryPlanner::AddSymbolicBuffer(tflite::ErrorReporter* error_reporter, const SymbolicBufferSize& size, int first_time_used, int last_time_used) {
+  return AddSymbolicBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool SymbolicMemoryPlanner::AddSymbolicBuffer(tflite::ErrorReporter* error_reporter, const SymbolicBufferSize& size, int first_time_used, int last_time_used, int alignment) {
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  symbolic_sizes_[buffer_count_] = size;
+  first_times_used_[buffer_count_] = first_time_used;
+  last_times_used_[buffer_count_] = last_time_used;
+  alignments_[buffer_count_] = alignment;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  have_buffers_changed_ = true;
+  return true;
+}
+
+bool SymbolicMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment);
+}
+
+bool SymbolicMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  SymbolicBufferSize symbolic_size = {};
+  symbolic_size.constant = size;
+  return AddSymbolicBuffer(error_reporter, symbolic_size, first_time_used, last_time_used, alignment);
+}
+
+void SymbolicMemoryPlanner::EvaluateSizes() {
+  for (int i = 0; i < buffer_count_; ++i) {
+    const SymbolicBufferSize& symbolic_size = symbolic_sizes_[i];
+    int64_t size = symbolic_size.constant;
+    for (int dimension = 0; dimension < kMaxSymbolicDimensionCount; ++dimension) {
+      size += static_cast<int64_t>(symbolic_size.coefficients[dimension]) * dimension_values_[dimension];
+    }
+    if (size < 0) {
+      size = 0;
+    } else if (size > 2147483647) {
+      size = 2147483647;
+    }
+    sizes_[i] = static_cast<int>(size);
+  }
+}
+
+void SymbolicMemoryPlanner::CalculateFullPlan() {
+  // The greedy planner can't run out of room or see a bad alignment, since
+  // both were checked when the buffers were added, so nothing is reported.
+  MicroErrorReporter error_reporter;
+  GreedyMemoryPlanner planner(greedy_scratch_buffer_, buffer_count_ * kGreedyScratchPerBuffer);
+  for (int i = 0; i < buffer_count_; ++i) {
+    planner.AddBuffer(&error_reporter, sizes_[i], first_times_used_[i], last_times_used_[i], alignments_[i]);
+  }
+  for (int i = 0; i < buffer_count_; ++i) {
+    planner.GetOffsetForBuffer(&error_reporter, i, &buffer_offsets_[i]);
+  }
+  arena_size_ = planner.GetMaximumMemorySize();
+  is_arrangement_recorded_ = RecordArrangement();
+}
+
+bool SymbolicMemoryPlanner::RecordArrangement() {
+  // Sorting by size, the greedy planner's default key, gives its placement
+  // order.
+  for (int i = 0; i < buffer_count_; ++i) {
+    sort_values_[i] = sizes_[i];
+    buffer_ids_in_placement_order_[i] = i;
+  }
+  ReverseSortWithScratch(sort_values_, buffer_ids_in_placement_order_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+
+  // Walking through the buffers in order of first use, each one overlaps the
+  // ones after it that start before it finishes, so every overlapping pair
+  // is visited once.
+  for (int i = 0; i < buffer_count_; ++i) {
+    sort_values_[i] = first_times_used_[i];
+    sort_ids_[i] = i;
+  }
+  SortWithScratch(sort_values_, sort_ids_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+  int* const placement_positions = sort_scratch_values_;
+  for (int position = 0; position < buffer_count_; ++position) {
+    placement_positions[buffer_ids_in_placement_order_[position]] = position;
+  }
+
+  // The first pass counts the overlaps stored with each buffer, and the
+  // second fills them in.
+  for (int i = 0; i <= buffer_count_; ++i) {
+    overlap_starts_[i] = 0;
+  }
+  int overlap_count = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < buffer_count_; ++i) {
+      const int buffer_id = sort_ids_[i];
+      for (int j = i + 1; (j < buffer_count_) && (sort_values_[j] <= last_times_used_[buffer_id]); ++j) {
+        const int other_id = sort_ids_[j];
+        int later_id = buffer_id;
+        int earlier_id = other_id;
+        if (placement_positions[other_id] > placement_positions[buffer_id]) {
+          later_id = other_id;
+          earlier_id = buffer_id;
+        }
+        if (pass == 0) {
+          ++overlap_count;
+          if (overlap_count > max_overlap_count_) {
+            return false;
+          }
+          ++overlap_starts_[later_id + 1];
+        } else {
+          const bool is_below = (buffer_offsets_[earlier_id] + sizes_[earlier_id]) <= buffer_offsets_[later_id];
+          overlaps_[overlap_starts_[later_id]] = is_below ? earlier_id : -(earlier_id + 1);
+          ++overlap_starts_[later_id];
+        }
+      }
+    }
+    if (pass == 0) {
+      for (int id = 0; id < buffer_count_; ++id) {
+        overlap_starts_[id + 1] += overlap_starts_[id];
+      }
+    } else {
+      // Filling in moved each start along to the next buffer's, so shift
+      // them back.
+      for (int id = buffer_count_; id > 0; --id) {
+        overlap_starts_[id] = overlap_starts_[id - 1];
+      }
+      overlap_starts_[0] = 0;
+    }
+  }
+  return true;
+}
+
+bool SymbolicMemoryPlanner::IsPlacementOrderUnchanged() const {
+  for (int position = 1; position < buffer_count_; ++position) {
+    const int previous_id = buffer_ids_in_placement_order_[position - 1];
+    const int buffer_id = buffer_ids_in_placement_order_[position];
+    const int previous_key = sizes_[previous_id];
+    const int key = sizes_[buffer_id];
+    if (key > previous_key) {
+      return false;
+    }
+    if ((key == previous_key) && (buffer_id < previous_id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SymbolicMemoryPlanner::ReevaluatePlan() {
+  int arena_size = 0;
+  for (int position = 0; position < buffer_count_; ++position) {
+    const int buffer_id = buffer_ids_in_placement_order_[position];
+    const int start = overlap_starts_[buffer_id];
+    const int end = overlap_starts_[buffer_id + 1];
+    int candidate_offset = 0;
+    for (int i = start; i < end; ++i) {
+      const int other_id = overlaps_[i];
+      if ((other_id >= 0) && ((buffer_offsets_[other_id] + sizes_[other_id]) > candidate_offset)) {
+        candidate_offset = buffer_offsets_[other_id] + sizes_[other_id];
+      }
+    }
+    int offset = AlignOffset(candidate_offset, alignments_[buffer_id]);
+    bool does_fit = true;
+    for (int i = start; i < end; ++i) {
+      const int other_id = overlaps_[i];
+      if ((other_id < 0) && ((offset + sizes_[buffer_id]) > buffer_offsets_[-(other_id + 1)])) {
+        does_fit = false;
+        break;
+      }
+    }
+    if (!does_fit) {
+      offset = ReplaceBuffer(buffer_id);
+    }
+    buffer_offsets_[buffer_id] = offset;
+    if ((offset + sizes_[buffer_id]) > arena_size) {
+      arena_size = offset + sizes_[buffer_id];
+    }
+  }
+  arena_size_ = arena_size;
+}
+
+int SymbolicMemoryPlanner::ReplaceBuffer(int buffer_id) {
+  // Search the gaps between the overlapping buffers the same way the greedy
+  // planner does, using the recorded overlaps rather than a time index.
+  const int start = overlap_starts_[buffer_id];
+  const int end = overlap_starts_[buffer_id + 1];
+  int active_count = 0;
+  for (int i = start; i < end; ++i) {
+    const int other_id = (overlaps_[i] >= 0) ? overlaps_[i] : -(overlaps_[i] + 1);
+    sort_values_[active_count] = buffer_offsets_[other_id];
+    sort_ids_[active_count] = buffer_offsets_[other_id] + sizes_[other_id];
+    ++active_count;
+  }
+  SortWithScratch(sort_values_, sort_ids_, active_count, sort_scratch_values_, sort_scratch_ids_);
+  const int offset = internal::ChooseFirstFitOffset(sort_values_, sort_ids_, active_count, sizes_[buffer_id], alignments_[buffer_id]);
+
+  // Record the new arrangement, so later re-evaluations start from it.
+  for (int i = start; i < end; ++i) {
+    const int other_id = (overlaps_[i] >= 0) ? overlaps_[i] : -(overlaps_[i] + 1);
+    const bool is_below = (buffer_offsets_[other_id] + sizes_[other_id]) <= offset;
+    overlaps_[i] = is_below ? other_id : -(other_id + 1);
+  }
+  return offset;
+}
+
+void SymbolicMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+  EvaluateSizes();
+  was_last_plan_reused_ = !have_buffers_changed_ && is_arrangement_recorded_ && IsPlacementOrderUnchanged();
+  if (was_last_plan_reused_) {
+    ReevaluatePlan();
+  } else {
+    CalculateFullPlan();
+  }
+  have_buffers_changed_ = false;
+}
+
+int SymbolicMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  return arena_size_;
+}
+
+int SymbolicMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool SymbolicMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+bool SymbolicMemoryPlanner::GetBufferSize(tflite::ErrorReporter* error_reporter, int buffer_index, int* size) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  *size = sizes_[buffer_index];
+  return true;
+}
+
+bool SymbolicMemoryPlanner::WasLastPlanReused() {
+  CalculateOffsetsIfNeeded();
+  return was_last_plan_reused_;
+}
+
+}  // namespace tflite
@@ -0,0 +1,174 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SYMBOLIC_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SYMBOLIC_MEMORY_PLANNER_H_
+
+#include "greedy_memory_planner.h"
+#include "memory_planner.h"
+
+namespace tflite {
+
+// How many symbolic dimensions, like batch size or sequence length, a buffer
+// size can depend on.
+constexpr int kMaxSymbolicDimensionCount = 4;
+
+// A buffer size that's an affine function of the symbolic dimensions, equal
+// to constant plus the sum of each coefficient multiplied by the value of
+// that dimension. Sizes that work out below zero are treated as zero.
+struct SymbolicBufferSize {
+  int constant;
+  int coefficients[kMaxSymbolicDimensionCount];
+};
+
+// A planner for graphs whose buffer sizes depend on dimensions that change
+// between runs, such as a serving path that sees a new batch size or
+// sequence length for each request. Buffers are added once with symbolic
+// sizes, and changing a dimension with SetDimensionValue() only re-evaluates
+// the plan, rather than planning from scratch.
+//
+// The first plan is made with the greedy algorithm, in the default size
+// order. Alongside it the planner records the placement order, and for each
+// buffer, which of the overlapping buffers placed before it ended up below it
+// and which above. After the dimensions change, if the new sizes still give
+// the same placement order, each buffer is put directly above the ones that
+// were below it before, and checked against the ones that were above it. That
+// takes one pass over the buffers and their overlaps, with no sorting or gap
+// searching. If a buffer no longer fits under the ones above it, only that
+// buffer is moved, to the first gap among the buffers it overlaps that's big
+// enough, and its new arrangement is recorded for later re-evaluations. If
+// the placement order has changed, the planner makes a full greedy plan and
+// records that instead.
+//
+// A re-evaluated plan only ever places buffers clear of the ones they
+// overlap, so it's always valid, and it's identical to a fresh greedy plan
+// when the sizes haven't changed. When buffers shrink, a fresh plan may find
+// lower gaps and a smaller arena.
+//
+// All working memory comes from a scratch buffer owned by the client. The
+// overlaps are stored in room for kOverlapsPerBuffer per buffer on average.
+// Graphs with more than that are still planned, but always from scratch.
+class SymbolicMemoryPlanner : public MemoryPlanner {
+ public:
+  SymbolicMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
+  virtual ~SymbolicMemoryPlanner() override;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including the greedy planner's working memory.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * (kPerBufferScratchSize + kGreedyScratchPerBuffer)) + sizeof(int) + (kScratchAlignment - 1);
+  }
+
+  // Sets the value of one of the symbolic dimensions, which all start at
+  // zero.
+  bool SetDimensionValue(tflite::ErrorReporter* error_reporter, int dimension, int value);
+
+  // Adds a buffer whose size depends on the symbolic dimensions.
+  bool AddSymbolicBuffer(tflite::ErrorReporter* error_reporter, const SymbolicBufferSize& size, int first_time_used, int last_time_used);
+  bool AddSymbolicBuffer(tflite::ErrorReporter* error_reporter, const SymbolicBufferSize& size, int first_time_used, int last_time_used, int alignment);
+
+  // Buffers added through the MemoryPlanner interface have a fixed size.
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+
+  virtual int GetMaximumMemorySize() override;
+  virtual int GetBufferCount() override;
+  virtual bool GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // The size of a buffer for the current dimension values.
+  bool GetBufferSize(tflite::ErrorReporter* error_reporter, int buffer_index, int* size);
+
+  // Whether the last plan was re-evaluated from the recorded arrangement,
+  // rather than made from scratch.
+  bool WasLastPlanReused();
+
+  // The average number of overlaps between buffers per buffer that there's
+  // room to record.
+  static constexpr int kOverlapsPerBuffer = 16;
+
+ private:
+  // Works out every buffer's size from the current dimension values.
+  void EvaluateSizes();
+
+  // Plans with the greedy algorithm and records the arrangement.
+  void CalculateFullPlan();
+
+  // Records which overlapping buffers were placed below and above each one.
+  // Returns false if there isn't room for all the overlaps.
+  bool RecordArrangement();
+
+  // Whether the current sizes give the same placement order as the recorded
+  // one.
+  bool IsPlacementOrderUnchanged() const;
+
+  // Places the buffers using the recorded arrangement.
+  void ReevaluatePlan();
+
+  // Finds a new place for a buffer that doesn't fit its recorded position,
+  // and records the new arrangement.
+  int ReplaceBuffer(int buffer_id);
+
+  // If there isn't an up to date plan, calculate a new one.
+  void CalculateOffsetsIfNeeded();
+
+  static constexpr int kScratchAlignment = alignof(int);
+  static constexpr int kIntsPerSymbolicSize = sizeof(SymbolicBufferSize) / sizeof(int);
+  static constexpr int kPerBufferScratchSize = sizeof(SymbolicBufferSize) + ((11 + kOverlapsPerBuffer) * sizeof(int));
+  static constexpr int kGreedyScratchPerBuffer = GreedyMemoryPlanner::GetScratchBufferSize(1);
+
+  int max_buffer_count_;
+  int buffer_count_;
+  int arena_size_;
+  int dimension_values_[kMaxSymbolicDimensionCount];
+  bool need_to_calculate_offsets_;
+  bool have_buffers_changed_;
+  bool is_arrangement_recorded_;
+  bool was_last_plan_reused_;
+
+  // The client-provided information about each buffer.
+  SymbolicBufferSize* symbolic_sizes_;
+  int* first_times_used_;
+  int* last_times_used_;
+  int* alignments_;
+
+  // The sizes for the current dimension values, and the offsets planned for
+  // them.
+  int* sizes_;
+  int* buffer_offsets_;
+
+  // The buffer ids in the order they were placed in the recorded plan.
+  int* buffer_ids_in_placement_order_;
+
+  // The overlaps for each buffer with ones placed before it, from
+  // overlaps_[overlap_starts_[id]] up to overlaps_[overlap_starts_[id + 1]].
+  // A buffer that was below is stored as its id, and one that was above as
+  // -(id + 1).
+  int* overlap_starts_;
+  int* overlaps_;
+  int max_overlap_count_;
+
+  // Working memory for sorting.
+  int* sort_values_;
+  int* sort_ids_;
+  int* sort_scratch_values_;
+  int* sort_scratch_ids_;
+
+  // Where the greedy planner's memory starts.
+  unsigned char* greedy_scratch_buffer_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_SYMBOLIC_MEMORY_PLANNER_H_
@@ -0,0 +1,218 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "symbolic_memory_planner.h"
+
+#include "micro_test.h"
+
+namespace {
+
+// Adds a buffer whose size is a multiple of the first dimension plus a
+// constant.
+bool AddScaledBuffer(tflite::ErrorReporter* error_reporter, tflite::SymbolicMemoryPlanner* planner, int constant, int coefficient, int first_time_used, int last_time_used) {
+  tflite::SymbolicBufferSize size = {};
+  size.constant = constant;
+  size.coefficients[0] = coefficient;
+  return planner->AddSymbolicBuffer(error_reporter, size, first_time_used, last_time_used);
+}
+
+}  // namespace
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestSymbolicReevaluation) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::SymbolicMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SymbolicMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 10));
+  TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 0, 10, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 0, 9, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 0, 8, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 0, 1, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(4, planner.GetBufferCount());
+  TF_LITE_MICRO_EXPECT_EQ(180, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.WasLastPlanReused());
+
+  // The fourth buffer fits in the gap between the second and third.
+  const int expected_offsets[] = {0, 0, 100, 90};
+  for (int i = 0; i < 4; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+
+  // Doubling every size keeps the order and the arrangement.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 20));
+  TF_LITE_MICRO_EXPECT_EQ(360, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.WasLastPlanReused());
+  for (int i = 0; i < 4; ++i) {
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i] * 2, offset);
+    int size = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetBufferSize(error_reporter, i, &size));
+  }
+  int size = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetBufferSize(error_reporter, 3, &size));
+  TF_LITE_MICRO_EXPECT_EQ(20, size);
+
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.SetDimensionValue(error_reporter, tflite::kMaxSymbolicDimensionCount, 1));
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 4, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetBufferSize(error_reporter, 4, &size));
+}
+
+TF_LITE_MICRO_TEST(TestSymbolicSizeChanges) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  constexpr int scratch_buffer_size = tflite::SymbolicMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SymbolicMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 90, 5, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 10, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(180, planner.GetMaximumMemorySize());
+
+  // The order stays the same, but the fourth buffer no longer fits under the
+  // third once the second grows, so it's moved on top.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(190, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.WasLastPlanReused());
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 3, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(180, offset);
+
+  // Growing it past the first buffer changes the order.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 4));
+  TF_LITE_MICRO_EXPECT_EQ(200, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.WasLastPlanReused());
+
+  // Setting a dimension to the value it already has keeps the plan.
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 4));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.WasLastPlanReused());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 5));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.WasLastPlanReused());
+  TF_LITE_MICRO_EXPECT_EQ(205, planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TEST(TestSymbolicMatchesGreedy) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // Most sizes are a multiple of the number of tokens in the batch, plus a
+  // small constant, and the rest are fixed, like weights. Once there are more
+  // tokens than the largest constant, the order stops changing.
+  constexpr int buffer_count = 300;
+  constexpr int scratch_buffer_size = tflite::SymbolicMemoryPlanner::GetScratchBufferSize(buffer_count);
+  constexpr int greedy_scratch_buffer_size = tflite::GreedyMemoryPlanner::GetScratchBufferSize(buffer_count);
+  static unsigned char scratch_buffer[scratch_buffer_size];
+  static unsigned char greedy_scratch_buffer[greedy_scratch_buffer_size];
+  tflite::SymbolicMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  static int first_times_used[buffer_count];
+  static int last_times_used[buffer_count];
+  unsigned int seed = 1;
+  for (int i = 0; i < buffer_count; ++i) {
+    tflite::SymbolicBufferSize size = {};
+    seed = (seed * 1103515245) + 12345;
+    if (((seed >> 16) % 8) == 0) {
+      size.constant = 20000 + ((seed >> 20) % 1000);
+    } else {
+      size.constant = (seed >> 20) % 16;
+      size.coefficients[0] = ((seed >> 24) % 64) + 1;
+    }
+    seed = (seed * 1103515245) + 12345;
+    first_times_used[i] = (seed >> 16) % 100;
+    seed = (seed * 1103515245) + 12345;
+    last_times_used[i] = first_times_used[i] + ((seed >> 16) % 4);
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.AddSymbolicBuffer(error_reporter, size, first_times_used[i], last_times_used[i], 4));
+  }
+
+  // Whether each plan was re-evaluated or made from scratch, it has to be
+  // valid, and the full plans have to match the greedy planner's.
+  int reused_count = 0;
+  int full_plan_count = 0;
+  for (int token_count = 1; token_count <= 256; token_count *= 2) {
+    planner.SetDimensionValue(error_reporter, 0, token_count);
+    const int arena_size = planner.GetMaximumMemorySize();
+    tflite::GreedyMemoryPlanner greedy_planner(greedy_scratch_buffer, greedy_scratch_buffer_size);
+    for (int i = 0; i < buffer_count; ++i) {
+      int size;
+      planner.GetBufferSize(error_reporter, i, &size);
+      greedy_planner.AddBuffer(error_reporter, size, first_times_used[i], last_times_used[i], 4);
+    }
+    const bool was_reused = planner.WasLastPlanReused();
+    if (was_reused) {
+      ++reused_count;
+    } else {
+      ++full_plan_count;
+      TF_LITE_MICRO_EXPECT_EQ(greedy_planner.GetMaximumMemorySize(), arena_size);
+    }
+    bool all_valid = true;
+    for (int i = 0; i < buffer_count; ++i) {
+      int offset;
+      int size;
+      planner.GetOffsetForBuffer(error_reporter, i, &offset);
+      planner.GetBufferSize(error_reporter, i, &size);
+      int greedy_offset;
+      greedy_planner.GetOffsetForBuffer(error_reporter, i, &greedy_offset);
+      if ((!was_reused && (offset != greedy_offset)) || ((offset % 4) != 0) || ((offset + size) > arena_size)) {
+        all_valid = false;
+      }
+      for (int j = 0; j < i; ++j) {
+        if ((first_times_used[i] > last_times_used[j]) || (first_times_used[j] > last_times_used[i])) {
+          continue;
+        }
+        int other_offset;
+        int other_size;
+        planner.GetOffsetForBuffer(error_reporter, j, &other_offset);
+        planner.GetBufferSize(error_reporter, j, &other_size);
+        if ((offset < (other_offset + other_size)) && (other_offset < (offset + size))) {
+          all_valid = false;
+        }
+      }
+    }
+    TF_LITE_MICRO_EXPECT_EQ(true, all_valid);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(true, reused_count > 0);
+  TF_LITE_MICRO_EXPECT_EQ(true, full_plan_count > 1);
+}
+
+TF_LITE_MICRO_TEST(TestSymbolicTooManyOverlaps) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // With every buffer in use at once, there are more overlaps than there's
+  // room to record, so every plan is made from scratch.
+  constexpr int buffer_count = 40;
+  constexpr int scratch_buffer_size = tflite::SymbolicMemoryPlanner::GetScratchBufferSize(buffer_count);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::SymbolicMemoryPlanner planner(scratch_buffer, scratch_buffer_size);
+  for (int i = 0; i < buffer_count; ++i) {
+    TF_LITE_MICRO_EXPECT_EQ(true, AddScaledBuffer(error_reporter, &planner, 0, 1, 0, 0));
+  }
+  TF_LITE_MICRO_EXPECT_EQ(false, AddScaledBuffer(error_reporter, &planner, 0, 1, 0, 0));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 2));
+  TF_LITE_MICRO_EXPECT_EQ(80, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.SetDimensionValue(error_reporter, 0, 3));
+  TF_LITE_MICRO_EXPECT_EQ(120, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.WasLastPlanReused());
+}
+
+TF_LITE_MICRO_TESTS_END
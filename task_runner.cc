@@ -0,0 +1,26 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "task_runner.h"
+
+namespace tflite {
+
+void SerialTaskRunner::RunTasks(void (*task_function)(void* context, int task_index), void* context, int task_count) {
+  for (int i = 0; i < task_count; ++i) {
+    task_function(context, i);
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,47 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TASK_RUNNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TASK_RUNNER_H_
+
+namespace tflite {
+
+// Interface for running a batch of independent tasks, so planners that do
+// several pieces of separate work can have them spread across threads on
+// systems that support them. The planners themselves never create threads,
+// since many of the devices they run on don't have any.
+class TaskRunner {
+ public:
+  TaskRunner() {}
+  virtual ~TaskRunner() {}
+
+  // Calls task_function(context, task_index) once for every task_index from
+  // zero to task_count - 1, and only returns once they have all finished.
+  // Tasks may run in any order, and at the same time as each other.
+  virtual void RunTasks(void (*task_function)(void* context, int task_index), void* context, int task_count) = 0;
+};
+
+// Runs every task one after another on the calling thread.
+class SerialTaskRunner : public TaskRunner {
+ public:
+  SerialTaskRunner() {}
+  virtual ~SerialTaskRunner() override {}
+
+  virtual void RunTasks(void (*task_function)(void* context, int task_index), void* context, int task_count) override;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TASK_RUNNER_H_
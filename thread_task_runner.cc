@@ -0,0 +1,53 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "thread_task_runner.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace tflite {
+
+ThreadTaskRunner::ThreadTaskRunner(int thread_count) : thread_count_(thread_count) {}
+
+void ThreadTaskRunner::RunTasks(void (*task_function)(void* context, int task_index), void* context, int task_count) {
+  // Each thread keeps claiming the next unstarted task until there are none
+  // left, so uneven task lengths still balance out.
+  std::atomic<int> next_task_index(0);
+  auto run_until_done = [&]() {
+    while (true) {
+      const int task_index = next_task_index.fetch_add(1);
+      if (task_index >= task_count) {
+        break;
+      }
+      task_function(context, task_index);
+    }
+  };
+  int extra_thread_count = thread_count_ - 1;
+  if (extra_thread_count > (task_count - 1)) {
+    extra_thread_count = task_count - 1;
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < extra_thread_count; ++i) {
+    threads.emplace_back(run_until_done);
+  }
+  run_until_done();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,41 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_THREAD_TASK_RUNNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_THREAD_TASK_RUNNER_H_
+
+#include "task_runner.h"
+
+namespace tflite {
+
+// Runs tasks across several threads, using std::thread. This is only for
+// hosts with a full C++ standard library, so it's kept separate from the
+// planners, which just see the TaskRunner interface.
+class ThreadTaskRunner : public TaskRunner {
+ public:
+  // The calling thread takes part in running tasks, so thread_count includes
+  // it. A thread_count of one runs everything on the calling thread.
+  explicit ThreadTaskRunner(int thread_count);
+  virtual ~ThreadTaskRunner() override {}
+
+  virtual void RunTasks(void (*task_function)(void* context, int task_index), void* context, int task_count) override;
+
+ private:
+  int thread_count_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_THREAD_TASK_RUNNER_H_
@@ -0,0 +1,245 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tiered_memory_planner.h"
+
+#include <cstdint>
+
+#include "reverse_sort_in_place.h"
+
+namespace tflite {
+
+TieredMemoryPlanner::TieredMemoryPlanner(const MemoryTier* tiers, int tier_count, unsigned char* scratch_buffer, int scratch_buffer_size)
+    : buffer_count_(0), need_to_calculate_offsets_(true) {
+  // An invalid count is recorded as zero tiers, so AddBuffer() will report it.
+  tier_count_ = ((tier_count < 1) || (tier_count > kMaxTierCount)) ? 0 : tier_count;
+  // Sort the tiers by cost, keeping the client's order for equal costs. There
+  // are only a few, so an insertion sort is simplest.
+  for (int i = 0; i < tier_count_; ++i) {
+    tiers_[i] = tiers[i];
+    int j = i;
+    while ((j > 0) && (tiers[tier_ids_in_cost_order_[j - 1]].cost > tiers[i].cost)) {
+      tier_ids_in_cost_order_[j] = tier_ids_in_cost_order_[j - 1];
+      --j;
+    }
+    tier_ids_in_cost_order_[j] = i;
+  }
+  for (int i = 0; i < kMaxTierCount; ++i) {
+    tier_sizes_[i] = 0;
+  }
+
+  const int misalignment = reinterpret_cast<uintptr_t>(scratch_buffer) % kScratchAlignment;
+  int alignment_padding = 0;
+  if (misalignment != 0) {
+    alignment_padding = kScratchAlignment - misalignment;
+  }
+  max_buffer_count_ = (scratch_buffer_size - alignment_padding) / kPerBufferScratchSize;
+  if (max_buffer_count_ < 0) {
+    max_buffer_count_ = 0;
+  }
+  int* next_array = reinterpret_cast<int*>(scratch_buffer + alignment_padding);
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_array);
+  next_array += max_buffer_count_ * (sizeof(BufferRequirements) / sizeof(int));
+  int** const arrays[] = {
+      &access_counts_,
+      &buffer_ids_in_placement_order_,
+      &sort_scratch_values_,
+      &sort_scratch_ids_,
+      &active_offsets_,
+      &active_ends_,
+      &buffer_tiers_,
+      &buffer_offsets_,
+  };
+  for (int** array : arrays) {
+    *array = next_array;
+    next_array += max_buffer_count_;
+  }
+  placement_order_keys_ = active_offsets_;
+}
+
+TieredMemoryPlanner::~TieredMemoryPlanner() {}
+
+bool TieredMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, kDefaultBufferAlignment, kDefaultAccessCount);
+}
+
+bool TieredMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used, alignment, kDefaultAccessCount);
+}
+
+bool TieredMemoryPlanner::AddBuffer(tflite::ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment, int access_count) {
+  if (tier_count_ == 0) {
+    error_reporter->Report("Planner needs between 1 and %d memory tiers", kMaxTierCount);
+    return false;
+  }
+  if (buffer_count_ >= max_buffer_count_) {
+    error_reporter->Report("Too many buffers (max is %d)", max_buffer_count_);
+    return false;
+  }
+  if (!IsValidBufferAlignment(alignment)) {
+    error_reporter->Report("Buffer alignment %d isn't a power of two", alignment);
+    return false;
+  }
+  BufferRequirements* current = &requirements_[buffer_count_];
+  current->size = size;
+  current->first_time_used = first_time_used;
+  current->last_time_used = last_time_used;
+  current->alignment = alignment;
+  access_counts_[buffer_count_] = access_count;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return true;
+}
+
+int TieredMemoryPlanner::FindOffsetInTier(int buffer_id, int tier, int placed_count, int capacity) {
+  const BufferRequirements* wanted = &requirements_[buffer_id];
+  int active_count = 0;
+  for (int i = 0; i < placed_count; ++i) {
+    const int placed_id = buffer_ids_in_placement_order_[i];
+    if (buffer_tiers_[placed_id] != tier) {
+      continue;
+    }
+    const BufferRequirements* placed = &requirements_[placed_id];
+    if ((placed->first_time_used > wanted->last_time_used) || (wanted->first_time_used > placed->last_time_used)) {
+      continue;
+    }
+    active_offsets_[active_count] = buffer_offsets_[placed_id];
+    active_ends_[active_count] = buffer_offsets_[placed_id] + placed->size;
+    ++active_count;
+  }
+  SortWithScratch(active_offsets_, active_ends_, active_count, sort_scratch_values_, sort_scratch_ids_);
+
+  // Take the lowest gap that's large enough, skipping past the highest end
+  // so far, since active buffers can overlap each other in memory.
+  int candidate_offset = 0;
+  int offset = -1;
+  for (int j = 0; j < active_count; ++j) {
+    const int aligned_offset = AlignOffset(candidate_offset, wanted->alignment);
+    if ((active_offsets_[j] - aligned_offset) >= wanted->size) {
+      offset = aligned_offset;
+      break;
+    }
+    if (active_ends_[j] > candidate_offset) {
+      candidate_offset = active_ends_[j];
+    }
+  }
+  if (offset == -1) {
+    offset = AlignOffset(candidate_offset, wanted->alignment);
+  }
+  // Any other gap would be higher, so if this doesn't fit, nothing will.
+  if ((offset + wanted->size) > capacity) {
+    return -1;
+  }
+  return offset;
+}
+
+void TieredMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+
+  // Sort by size and then by access count. Both sorts are stable, so buffers
+  // with the same count end up largest first.
+  for (int i = 0; i < buffer_count_; ++i) {
+    placement_order_keys_[i] = requirements_[i].size;
+    buffer_ids_in_placement_order_[i] = i;
+  }
+  ReverseSortWithScratch(placement_order_keys_, buffer_ids_in_placement_order_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+  for (int i = 0; i < buffer_count_; ++i) {
+    placement_order_keys_[i] = access_counts_[buffer_ids_in_placement_order_[i]];
+  }
+  ReverseSortWithScratch(placement_order_keys_, buffer_ids_in_placement_order_, buffer_count_, sort_scratch_values_, sort_scratch_ids_);
+
+  for (int i = 0; i < kMaxTierCount; ++i) {
+    tier_sizes_[i] = 0;
+  }
+  const int most_expensive_tier = tier_ids_in_cost_order_[tier_count_ - 1];
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_in_placement_order_[i];
+    int tier = -1;
+    int offset = -1;
+    for (int t = 0; t < tier_count_; ++t) {
+      const int candidate_tier = tier_ids_in_cost_order_[t];
+      offset = FindOffsetInTier(buffer_id, candidate_tier, i, tiers_[candidate_tier].capacity);
+      if (offset != -1) {
+        tier = candidate_tier;
+        break;
+      }
+    }
+    // There's nowhere with room, so overflow the most expensive tier.
+    if (tier == -1) {
+      tier = most_expensive_tier;
+      offset = FindOffsetInTier(buffer_id, tier, i, kUnlimitedCapacity);
+    }
+    buffer_tiers_[buffer_id] = tier;
+    buffer_offsets_[buffer_id] = offset;
+    const int end = offset + requirements_[buffer_id].size;
+    if (end > tier_sizes_[tier]) {
+      tier_sizes_[tier] = end;
+    }
+  }
+}
+
+int TieredMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  int total_size = 0;
+  for (int i = 0; i < tier_count_; ++i) {
+    total_size += tier_sizes_[i];
+  }
+  return total_size;
+}
+
+int TieredMemoryPlanner::GetMaximumMemorySize(int tier) {
+  if ((tier < 0) || (tier >= tier_count_)) {
+    return 0;
+  }
+  CalculateOffsetsIfNeeded();
+  return tier_sizes_[tier];
+}
+
+int TieredMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+bool TieredMemoryPlanner::GetOffsetForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  CalculateOffsetsIfNeeded();
+  *offset = buffer_offsets_[buffer_index];
+  return true;
+}
+
+bool TieredMemoryPlanner::GetTierForBuffer(tflite::ErrorReporter* error_reporter, int buffer_index, int* tier) {
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    error_reporter->Report("buffer index %d is outside range 0 to %d", buffer_index, buffer_count_);
+    return false;
+  }
+  CalculateOffsetsIfNeeded();
+  *tier = buffer_tiers_[buffer_index];
+  return true;
+}
+
+bool TieredMemoryPlanner::IsWithinCapacity() {
+  CalculateOffsetsIfNeeded();
+  for (int i = 0; i < tier_count_; ++i) {
+    if (tier_sizes_[i] > tiers_[i].capacity) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace tflite
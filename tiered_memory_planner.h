@@ -0,0 +1,155 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIERED_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIERED_MEMORY_PLANNER_H_
+
+#include "memory_planner.h"
+
+namespace tflite {
+
+// Describes one kind of memory that buffers can be placed in, like a small
+// fast scratchpad or a large slow DRAM.
+struct MemoryTier {
+  // How many bytes the tier can hold.
+  int capacity;
+  // How expensive it is to access, relative to the other tiers. Only the
+  // order matters, so this can be a latency, energy per byte, or a rank.
+  int cost;
+};
+
+// A memory planner for systems with several kinds of memory, each with its
+// own arena. Every buffer is assigned a tier and an offset within that
+// tier's arena.
+//
+// The algorithm works like this:
+//  - The client lists the tiers, and enters the buffer information through
+//    AddBuffer(), optionally with how often each buffer is accessed.
+//  - Buffers are sorted by access count, so the ones that benefit most from
+//    fast memory come first. Buffers with the same count are sorted by size,
+//    largest first, as in GreedyMemoryPlanner.
+//  - The tiers are tried from cheapest to most expensive. In each one, the
+//    buffer goes in the lowest gap between active buffers in that tier that's
+//    large enough, as long as it ends within the tier's capacity.
+//  - If no tier has room, the buffer goes in the most expensive tier anyway,
+//    and IsWithinCapacity() will return false.
+//
+// Each tier is searched by scanning every buffer already placed in it, so
+// planning takes O(n^2 log n) time. That's fine for the few hundred buffers
+// typical of accelerator graphs.
+//
+// Like the other planners, no memory is allocated. The working arrays are
+// held in a scratch buffer provided by the client.
+class TieredMemoryPlanner : public MemoryPlanner {
+ public:
+  // The tiers are copied, so the array doesn't need to outlive the planner.
+  // There can be up to kMaxTierCount of them. Tier indices used by the
+  // planner refer to positions in this array. The scratch buffer has the same
+  // requirements as GreedyMemoryPlanner's.
+  TieredMemoryPlanner(const MemoryTier* tiers, int tier_count, unsigned char* scratch_buffer, int scratch_buffer_size);
+  virtual ~TieredMemoryPlanner() override;
+
+  static constexpr int kMaxTierCount = 4;
+
+  // The access count buffers get if none is given.
+  static constexpr int kDefaultAccessCount = 1;
+
+  // How many bytes of scratch memory are needed to plan up to this many
+  // buffers, including room for alignment.
+  static constexpr int GetScratchBufferSize(int max_buffer_count) {
+    return (max_buffer_count * kPerBufferScratchSize) + (kScratchAlignment - 1);
+  }
+
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used) override;
+  virtual bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment) override;
+
+  // Adds a buffer that's accessed access_count times while it's active. The
+  // planner tries to put the buffers with the highest counts in the cheapest
+  // tiers, which maximizes the number of bytes accessed in fast memory.
+  bool AddBuffer(ErrorReporter* error_reporter, int size, int first_time_used, int last_time_used, int alignment, int access_count);
+
+  // The total arena size over all tiers.
+  virtual int GetMaximumMemorySize() override;
+
+  // The arena size needed for one tier.
+  int GetMaximumMemorySize(int tier);
+
+  virtual int GetBufferCount() override;
+
+  // Where a buffer should be placed within its tier's arena.
+  virtual bool GetOffsetForBuffer(ErrorReporter* error_reporter, int buffer_index, int* offset) override;
+
+  // Which tier a buffer should be placed in.
+  bool GetTierForBuffer(ErrorReporter* error_reporter, int buffer_index, int* tier);
+
+  // Whether every tier's arena fits within its capacity. This is only false
+  // if the buffers active at some point are too large for all the tiers put
+  // together, or can't be packed into them.
+  bool IsWithinCapacity();
+
+ private:
+  // Finds the lowest offset in a tier where a buffer fits, around the first
+  // placed_count buffers in the placement order, without going past the
+  // capacity. Returns -1 if there's no room.
+  int FindOffsetInTier(int buffer_id, int tier, int placed_count, int capacity);
+
+  // If there isn't an up to date plan, calculate a new one.
+  void CalculateOffsetsIfNeeded();
+
+  static constexpr int kScratchAlignment = alignof(int);
+
+  // Used as the capacity when a tier has to take buffers that don't fit.
+  static constexpr int kUnlimitedCapacity = 2147483647;
+
+  // Requirements, plus the eight int arrays below that have their own memory.
+  static constexpr int kPerBufferScratchSize = sizeof(BufferRequirements) + (8 * sizeof(int));
+
+  // The client's tiers, and their indices in order of increasing cost. The
+  // count is zero if the client passed in too few or too many.
+  MemoryTier tiers_[kMaxTierCount];
+  int tier_ids_in_cost_order_[kMaxTierCount];
+  int tier_count_;
+
+  BufferRequirements* requirements_;
+  int max_buffer_count_;
+  int buffer_count_;
+
+  // Working arrays, all pointing into the client's scratch buffer.
+  int* access_counts_;
+  int* buffer_ids_in_placement_order_;
+  int* sort_scratch_values_;
+  int* sort_scratch_ids_;
+
+  // The placed buffers that are active at the same time as the one being
+  // placed, sorted by offset. The sort keys for the placement order share
+  // memory with these, since they're only needed before placement starts.
+  int* active_offsets_;
+  int* active_ends_;
+  int* placement_order_keys_;
+
+  // The outcome of the plan.
+  int* buffer_tiers_;
+  int* buffer_offsets_;
+
+  // The arena size each tier needs for the current plan.
+  int tier_sizes_[kMaxTierCount];
+
+  // Whether buffers have been added since the last plan was calculated.
+  bool need_to_calculate_offsets_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIERED_MEMORY_PLANNER_H_
@@ -0,0 +1,100 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tiered_memory_planner.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestTieredBasics) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  // The slow tier is listed first, to check they're sorted by cost.
+  const tflite::MemoryTier tiers[] = {
+      {1000, 10},
+      {100, 1},
+  };
+  constexpr int scratch_buffer_size = tflite::TieredMemoryPlanner::GetScratchBufferSize(16);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::TieredMemoryPlanner planner(tiers, 2, scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 80, 0, 1, 1, 10));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 60, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 50, 2, 3, 1, 5));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 0, 0, 1, 2));
+  TF_LITE_MICRO_EXPECT_EQ(4, planner.GetBufferCount());
+
+  // The most accessed buffers share the fast tier, since they're never
+  // active at the same time, and the others spill into the slow one.
+  const int expected_tiers[] = {1, 0, 1, 0};
+  const int expected_offsets[] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    int tier = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetTierForBuffer(error_reporter, i, &tier));
+    TF_LITE_MICRO_EXPECT_EQ(expected_tiers[i], tier);
+    int offset = -1;
+    TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, i, &offset));
+    TF_LITE_MICRO_EXPECT_EQ(expected_offsets[i], offset);
+  }
+  TF_LITE_MICRO_EXPECT_EQ(80, planner.GetMaximumMemorySize(1));
+  TF_LITE_MICRO_EXPECT_EQ(60, planner.GetMaximumMemorySize(0));
+  TF_LITE_MICRO_EXPECT_EQ(140, planner.GetMaximumMemorySize());
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.IsWithinCapacity());
+
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetOffsetForBuffer(error_reporter, 4, &offset));
+  int tier = -1;
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.GetTierForBuffer(error_reporter, -1, &tier));
+}
+
+TF_LITE_MICRO_TEST(TestTieredOverflow) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+  const tflite::MemoryTier tiers[] = {
+      {64, 1},
+      {128, 4},
+  };
+  constexpr int scratch_buffer_size = tflite::TieredMemoryPlanner::GetScratchBufferSize(4);
+  unsigned char scratch_buffer[scratch_buffer_size];
+  tflite::TieredMemoryPlanner planner(tiers, 2, scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 48, 0, 1, 16));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 100, 0, 1, 16));
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.AddBuffer(error_reporter, 40, 1, 1, 16));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.AddBuffer(error_reporter, 10, 1, 1, 3));
+
+  // The largest buffer only fits in the slow tier, and the smallest doesn't
+  // fit in either, so the slow tier has to grow past its capacity.
+  TF_LITE_MICRO_EXPECT_EQ(48, planner.GetMaximumMemorySize(0));
+  TF_LITE_MICRO_EXPECT_EQ(152, planner.GetMaximumMemorySize(1));
+  TF_LITE_MICRO_EXPECT_EQ(false, planner.IsWithinCapacity());
+  int tier = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetTierForBuffer(error_reporter, 2, &tier));
+  TF_LITE_MICRO_EXPECT_EQ(1, tier);
+  int offset = -1;
+  TF_LITE_MICRO_EXPECT_EQ(true, planner.GetOffsetForBuffer(error_reporter, 2, &offset));
+  TF_LITE_MICRO_EXPECT_EQ(112, offset);
+
+  // Too many tiers can't be used.
+  const tflite::MemoryTier many_tiers[] = {
+      {10, 1}, {10, 2}, {10, 3}, {10, 4}, {10, 5},
+  };
+  tflite::TieredMemoryPlanner invalid_planner(many_tiers, 5, scratch_buffer, scratch_buffer_size);
+  TF_LITE_MICRO_EXPECT_EQ(false, invalid_planner.AddBuffer(error_reporter, 10, 0, 1));
+  TF_LITE_MICRO_EXPECT_EQ(0, invalid_planner.GetMaximumMemorySize());
+}
+
+TF_LITE_MICRO_TESTS_END
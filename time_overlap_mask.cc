@@ -0,0 +1,87 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "time_overlap_mask.h"
+
+#if !defined(TF_LITE_MEMORY_PLANNER_NO_SIMD)
+#if defined(__AVX2__)
+#define TF_LITE_MEMORY_PLANNER_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define TF_LITE_MEMORY_PLANNER_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TF_LITE_MEMORY_PLANNER_USE_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace tflite {
+
+uint32_t CalculateTimeOverlapMaskScalar(const int* first_times, const int* last_times, int count, int first_time_used, int last_time_used) {
+  uint32_t mask = 0;
+  for (int i = 0; i < count; ++i) {
+    if ((first_times[i] <= last_time_used) && (last_times[i] >= first_time_used)) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+}
+
+uint32_t CalculateTimeOverlapMask(const int* first_times, const int* last_times, int count, int first_time_used, int last_time_used) {
+  uint32_t mask = 0;
+  int i = 0;
+  // A buffer overlaps unless it starts after the range or ends before it, so
+  // each lane is two greater-than comparisons and an or, inverted at the end.
+#if defined(TF_LITE_MEMORY_PLANNER_USE_AVX2)
+  const __m256i wanted_first = _mm256_set1_epi32(first_time_used);
+  const __m256i wanted_last = _mm256_set1_epi32(last_time_used);
+  for (; (i + 8) <= count; i += 8) {
+    const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first_times + i));
+    const __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last_times + i));
+    const __m256i disjoint = _mm256_or_si256(_mm256_cmpgt_epi32(first, wanted_last), _mm256_cmpgt_epi32(wanted_first, last));
+    const uint32_t disjoint_bits = _mm256_movemask_ps(_mm256_castsi256_ps(disjoint));
+    mask |= (~disjoint_bits & 0xffu) << i;
+  }
+#elif defined(TF_LITE_MEMORY_PLANNER_USE_SSE2)
+  const __m128i wanted_first = _mm_set1_epi32(first_time_used);
+  const __m128i wanted_last = _mm_set1_epi32(last_time_used);
+  for (; (i + 4) <= count; i += 4) {
+    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first_times + i));
+    const __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last_times + i));
+    const __m128i disjoint = _mm_or_si128(_mm_cmpgt_epi32(first, wanted_last), _mm_cmpgt_epi32(wanted_first, last));
+    const uint32_t disjoint_bits = _mm_movemask_ps(_mm_castsi128_ps(disjoint));
+    mask |= (~disjoint_bits & 0xfu) << i;
+  }
+#elif defined(TF_LITE_MEMORY_PLANNER_USE_NEON)
+  // NEON has no movemask, so each lane keeps its own bit and they're summed.
+  const int32x4_t wanted_first = vdupq_n_s32(first_time_used);
+  const int32x4_t wanted_last = vdupq_n_s32(last_time_used);
+  static const uint32_t kLaneBits[4] = {1, 2, 4, 8};
+  const uint32x4_t lane_bits = vld1q_u32(kLaneBits);
+  for (; (i + 4) <= count; i += 4) {
+    const int32x4_t first = vld1q_s32(first_times + i);
+    const int32x4_t last = vld1q_s32(last_times + i);
+    const uint32x4_t overlaps = vandq_u32(vcleq_s32(first, wanted_last), vcgeq_s32(last, wanted_first));
+    mask |= vaddvq_u32(vandq_u32(overlaps, lane_bits)) << i;
+  }
+#endif
+  if (i < count) {
+    mask |= CalculateTimeOverlapMaskScalar(first_times + i, last_times + i, count - i, first_time_used, last_time_used) << i;
+  }
+  return mask;
+}
+
+}  // namespace tflite
@@ -0,0 +1,42 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIME_OVERLAP_MASK_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIME_OVERLAP_MASK_H_
+
+#include <cstdint>
+
+namespace tflite {
+
+// The most entries a single mask can cover.
+constexpr int kMaxTimeOverlapMaskCount = 32;
+
+// Tests a run of buffers against a time range, and sets bit i of the result
+// if the buffer with first_times[i] and last_times[i] is in use at some point
+// from first_time_used to last_time_used inclusive. The times are in
+// separate arrays so they can be loaded straight into vector registers, and
+// count can be at most kMaxTimeOverlapMaskCount.
+//
+// This uses AVX2 or SSE2 on x86, and NEON on 64-bit Arm, depending on what
+// the compiler is targeting. Defining TF_LITE_MEMORY_PLANNER_NO_SIMD forces
+// the scalar version, for example to compare the two.
+uint32_t CalculateTimeOverlapMask(const int* first_times, const int* last_times, int count, int first_time_used, int last_time_used);
+
+// The plain C++ version, always available for testing and benchmarking.
+uint32_t CalculateTimeOverlapMaskScalar(const int* first_times, const int* last_times, int count, int first_time_used, int last_time_used);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_MEMORY_PLANNER_TIME_OVERLAP_MASK_H_
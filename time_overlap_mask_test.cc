@@ -0,0 +1,55 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "time_overlap_mask.h"
+
+#include "micro_test.h"
+
+TF_LITE_MICRO_TESTS_BEGIN
+
+TF_LITE_MICRO_TEST(TestTimeOverlapMask) {
+  const int first_times[] = {0, 2, 5, 7, -2147483647 - 1};
+  const int last_times[] = {1, 4, 5, 9, -2147483647 - 1};
+  // Only the buffers in use somewhere from 3 to 5 overlap.
+  TF_LITE_MICRO_EXPECT_EQ(0x6u, tflite::CalculateTimeOverlapMask(first_times, last_times, 5, 3, 5));
+  TF_LITE_MICRO_EXPECT_EQ(0x6u, tflite::CalculateTimeOverlapMaskScalar(first_times, last_times, 5, 3, 5));
+  TF_LITE_MICRO_EXPECT_EQ(0x1u, tflite::CalculateTimeOverlapMask(first_times, last_times, 5, 1, 1));
+  TF_LITE_MICRO_EXPECT_EQ(0u, tflite::CalculateTimeOverlapMask(first_times, last_times, 0, 0, 10));
+}
+
+TF_LITE_MICRO_TEST(TestTimeOverlapMaskMatchesScalar) {
+  constexpr int max_count = tflite::kMaxTimeOverlapMaskCount;
+  int first_times[max_count + 1];
+  int last_times[max_count + 1];
+  unsigned int seed = 1;
+  for (int trial = 0; trial < 200; ++trial) {
+    for (int i = 0; i <= max_count; ++i) {
+      seed = (seed * 1103515245) + 12345;
+      first_times[i] = (seed >> 16) % 40;
+      seed = (seed * 1103515245) + 12345;
+      last_times[i] = first_times[i] + ((seed >> 16) % 8);
+    }
+    seed = (seed * 1103515245) + 12345;
+    const int first_time_used = (seed >> 16) % 40;
+    const int last_time_used = first_time_used + (trial % 6);
+    // Start at an odd position too, so the loads aren't always aligned.
+    const int start = trial % 2;
+    for (int count = 0; count <= (max_count - start); ++count) {
+      TF_LITE_MICRO_EXPECT_EQ(tflite::CalculateTimeOverlapMaskScalar(first_times + start, last_times + start, count, first_time_used, last_time_used), tflite::CalculateTimeOverlapMask(first_times + start, last_times + start, count, first_time_used, last_time_used));
+    }
+  }
+}
+
+TF_LITE_MICRO_TESTS_END